@@ -0,0 +1,25 @@
+#pragma once
+
+#include <bcos-framework/interfaces/executor/ExecutionMessage.h>
+#include <bcos-framework/libutilities/Error.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Optional interface of an executor taking every message of a DMT round in one call, e.g. a remote
+// executor saving the round trip per message. Responses are indexed as the inputs, static call
+// messages are executed as call does
+class BatchExecutorInterface
+{
+public:
+    using Ptr = std::shared_ptr<BatchExecutorInterface>;
+
+    virtual ~BatchExecutorInterface() = default;
+
+    virtual void executeTransactions(std::vector<protocol::ExecutionMessage::UniquePtr> inputs,
+        std::function<void(Error::UniquePtr, std::vector<protocol::ExecutionMessage::UniquePtr>)>
+            callback) = 0;
+};
+}  // namespace bcos::scheduler
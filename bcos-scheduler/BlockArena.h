@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace bcos::scheduler
+{
+// Monotonic memory of a block, nothing is freed until the arena is destroyed with the block, so
+// it holds what the block appends. Memory freed and taken again goes through a pool over it. Not
+// synchronized: the block is only changed by one thread at a time, parallel passes reserve what
+// they may append beforehand
+class BlockArena : public std::pmr::memory_resource
+{
+public:
+    BlockArena() = default;
+    BlockArena(const BlockArena&) = delete;
+    BlockArena(BlockArena&&) = delete;
+    BlockArena& operator=(const BlockArena&) = delete;
+    BlockArena& operator=(BlockArena&&) = delete;
+
+    size_t allocations() const { return m_allocations; }
+    size_t allocatedBytes() const { return m_allocatedBytes; }
+    size_t upstreamAllocations() const { return m_upstream.allocations; }
+    size_t upstreamBytes() const { return m_upstream.bytes; }
+
+private:
+    static constexpr size_t INITIAL_SIZE = 64 * 1024;
+
+    // Chunks of the arena from the heap
+    struct Upstream : public std::pmr::memory_resource
+    {
+        size_t allocations = 0;
+        size_t bytes = 0;
+
+        void* do_allocate(size_t size, size_t alignment) override
+        {
+            ++allocations;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        ++m_allocations;
+        m_allocatedBytes += size;
+        return m_monotonic.allocate(size, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    Upstream m_upstream;
+    std::pmr::monotonic_buffer_resource m_monotonic{INITIAL_SIZE, &m_upstream};
+    size_t m_allocations = 0;
+    size_t m_allocatedBytes = 0;
+};
+
+// Allocations served by the arenas of executed blocks and the heap chunks behind them
+struct BlockArenaStatistics
+{
+    std::atomic_size_t blocks = 0;
+    std::atomic_size_t allocations = 0;
+    std::atomic_size_t allocatedBytes = 0;
+    std::atomic_size_t upstreamAllocations = 0;
+    std::atomic_size_t upstreamBytes = 0;
+
+    void record(const BlockArena& arena)
+    {
+        ++blocks;
+        allocations += arena.allocations();
+        allocatedBytes += arena.allocatedBytes();
+        upstreamAllocations += arena.upstreamAllocations();
+        upstreamBytes += arena.upstreamBytes();
+    }
+};
+}  // namespace bcos::scheduler
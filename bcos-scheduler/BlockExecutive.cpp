@@ -1,6 +1,12 @@
 #include "BlockExecutive.h"
 #include "ChecksumAddress.h"
+#include "ExecutionModeSelector.h"
+#include "KeyLockDeclaringExecutorInterface.h"
+#include "KeyLockDeltaExecutorInterface.h"
+#include "KeyLocksMessage.h"
 #include "SchedulerImpl.h"
+#include "SpeculativeExecutorInterface.h"
+#include "TransactionInputMessage.h"
 #include "bcos-framework/interfaces/executor/PrecompiledTypeDef.h"
 #include "bcos-framework/libstorage/StateStorage.h"
 #include "bcos-scheduler/Common.h"
@@ -9,6 +15,8 @@
 #include "interfaces/protocol/Transaction.h"
 #include "libexecutor/NativeExecutionMessage.h"
 #include "libutilities/Error.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #include <boost/algorithm/hex.hpp>
 #include <boost/asio/defer.hpp>
@@ -18,11 +26,15 @@
 #include <boost/thread/latch.hpp>
 #include <boost/thread/lock_options.hpp>
 #include <boost/throw_exception.hpp>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <iterator>
+#include <numeric>
+#include <string_view>
 #include <thread>
+#include <unordered_set>
 #include <utility>
 
 using namespace bcos::scheduler;
@@ -39,165 +51,55 @@ void BlockExecutive::asyncExecute(
 
     m_currentTimePoint = std::chrono::system_clock::now();
 
-    bool withDAG = false;
-    if (m_block->transactionsMetaDataSize() > 0)
+    // Executors switch to the block while the messages are prepared
+    if (!m_staticCall)
     {
-        SCHEDULER_LOG(DEBUG) << LOG_KV("block number", m_block->blockHeaderConst()->number())
-                             << LOG_KV("meta tx count", m_block->transactionsMetaDataSize());
-
-        m_executiveResults.resize(m_block->transactionsMetaDataSize());
-        for (size_t i = 0; i < m_block->transactionsMetaDataSize(); ++i)
-        {
-            auto metaData = m_block->transactionMetaData(i);
-
-            auto message = m_scheduler->m_executionMessageFactory->createExecutionMessage();
-            message->setContextID(i + m_startContextID);
-            message->setType(protocol::ExecutionMessage::TXHASH);
-            message->setTransactionHash(metaData->hash());
-
-            if (metaData->attribute() & bcos::protocol::Transaction::Attribute::LIQUID_SCALE_CODEC)
-            {
-                // LIQUID
-                if (metaData->attribute() & bcos::protocol::Transaction::Attribute::LIQUID_CREATE)
-                {
-                    message->setCreate(true);
-                }
-                message->setTo(std::string(metaData->to()));
-            }
-            else
-            {
-                // SOLIDITY
-                if (metaData->to().empty())
-                {
-                    message->setCreate(true);
-                }
-                else
-                {
-                    message->setTo(preprocessAddress(metaData->to()));
-                }
-            }
-
-            message->setDepth(0);
-            message->setGasAvailable(TRANSACTION_GAS);
-            message->setStaticCall(false);
-
-            if (metaData->attribute() & bcos::protocol::Transaction::Attribute::DAG)
-            {
-                withDAG = true;
-            }
-
-            auto to = message->to();
-            m_executiveStates.emplace(
-                std::make_tuple(std::move(to), i), ExecutiveState(i, std::move(message), withDAG));
-
-            if (metaData)
-            {
-                m_executiveResults[i].transactionHash = metaData->hash();
-                m_executiveResults[i].source = metaData->source();
-            }
-        }
+        batchNextBlock();
     }
-    else if (m_block->transactionsSize() > 0)
-    {
-        SCHEDULER_LOG(DEBUG) << LOG_KV("block number", m_block->blockHeaderConst()->number())
-                             << LOG_KV("tx count", m_block->transactionsSize());
-
-        m_executiveResults.resize(m_block->transactionsSize());
-        for (size_t i = 0; i < m_block->transactionsSize(); ++i)
-        {
-            auto tx = m_block->transaction(i);
-            m_executiveResults[i].transactionHash = tx->hash();
-            m_executiveResults[i].source = tx->source();
-
-            auto message = m_scheduler->m_executionMessageFactory->createExecutionMessage();
-            message->setType(protocol::ExecutionMessage::MESSAGE);
-            message->setContextID(i + m_startContextID);
-
-            message->setOrigin(toHex(tx->sender()));
-            message->setFrom(std::string(message->origin()));
-
-
-            if (tx->attribute() & bcos::protocol::Transaction::Attribute::LIQUID_SCALE_CODEC)
-            {
-                // LIQUID
-                if (tx->attribute() & bcos::protocol::Transaction::Attribute::LIQUID_CREATE)
-                {
-                    message->setCreate(true);
-                }
-                message->setTo(std::string(tx->to()));
-            }
-            else
-            {
-                // SOLIDITY
-                if (tx->to().empty())
-                {
-                    message->setCreate(true);
-                }
-                else
-                {
-                    if (m_scheduler->m_isAuthCheck && !m_staticCall &&
-                        m_block->blockHeaderConst()->number() == 0 &&
-                        tx->to() == precompiled::AUTH_COMMITTEE_ADDRESS)
-                    {
-                        // if enable auth check, and first deploy auth contract
-                        message->setCreate(true);
-                    }
-                    message->setTo(preprocessAddress(tx->to()));
-                }
-            }
 
-            message->setDepth(0);
-            message->setGasAvailable(TRANSACTION_GAS);
-            message->setData(tx->input().toBytes());
-            message->setStaticCall(m_staticCall);
+    auto withDAG = prepareExecutiveStates();
+    m_unfinishedStates = m_executiveStates.size();
+    chooseScheduleMode(withDAG);
 
-            if (tx->attribute() & bcos::protocol::Transaction::Attribute::DAG)
-            {
-                withDAG = true;
-            }
-
-            auto to = std::string(message->to());
-            m_executiveStates.emplace(
-                std::make_tuple(std::move(to), i), ExecutiveState(i, std::move(message), withDAG));
-        }
-    }
+    auto now = std::chrono::system_clock::now();
+    m_prepareElapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - m_currentTimePoint);
+    m_currentTimePoint = now;
+    SCHEDULER_LOG(DEBUG) << LOG_KV("block number", m_block->blockHeaderConst()->number())
+                         << LOG_KV("prepared", m_executiveStates.size())
+                         << LOG_KV("prepare elapsed(ms)", m_prepareElapsed.count());
 
-    if (!m_staticCall)
+    if (withDAG)
     {
-        // Execute nextBlock
-        batchNextBlock([this, withDAG, callback = std::move(callback)](Error::UniquePtr error) {
+        DAGExecute([this, callback = std::move(callback)](Error::UniquePtr error) {
             if (error)
             {
                 SCHEDULER_LOG(ERROR)
-                    << "Next block with error!" << boost::diagnostic_information(*error);
+                    << "DAG execute block with error!" << boost::diagnostic_information(*error);
                 callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
-                             SchedulerError::NextBlockError, "Next block error!", *error),
+                             SchedulerError::DAGError, "DAG execute error!", *error),
                     nullptr);
                 return;
             }
 
-            if (withDAG)
-            {
-                DAGExecute([this, callback = std::move(callback)](Error::UniquePtr error) {
-                    if (error)
-                    {
-                        SCHEDULER_LOG(ERROR) << "DAG execute block with error!"
-                                             << boost::diagnostic_information(*error);
-                        callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
-                                     SchedulerError::DAGError, "DAG execute error!", *error),
-                            nullptr);
-                        return;
-                    }
-
-                    DMTExecute(std::move(callback));
-                });
-            }
-            else
-            {
-                DMTExecute(std::move(callback));
-            }
+            DMTExecute(std::move(callback));
         });
     }
+    else if (m_scheduleMode == DMTScheduleMode::OPTIMISTIC)
+    {
+        optimisticExecute(speculativeExecutor(),
+            [this, callback = std::move(callback)](Error::UniquePtr error) {
+                if (error)
+                {
+                    callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                                 SchedulerError::SpeculationError, "Speculate with errors", *error),
+                        nullptr);
+                    return;
+                }
+
+                DMTFinish(callback);
+            });
+    }
     else
     {
         DMTExecute(std::move(callback));
@@ -267,7 +169,8 @@ void BlockExecutive::asyncCommit(std::function<void(Error::UniquePtr)> callback)
                     m_commitElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
                         std::chrono::system_clock::now() - m_currentTimePoint);
                     SCHEDULER_LOG(INFO) << "CommitBlock: " << number()
-                                        << " success, execute elapsed: " << m_executeElapsed.count()
+                                        << " success, prepare elapsed: " << m_prepareElapsed.count()
+                                        << "ms execute elapsed: " << m_executeElapsed.count()
                                         << "ms hash elapsed: " << m_hashElapsed.count()
                                         << "ms commit elapsed: " << m_commitElapsed.count() << "ms";
 
@@ -364,15 +267,66 @@ void BlockExecutive::asyncNotify(
     });
 }
 
+void BlockExecutive::chooseScheduleMode(bool withDAG)
+{
+    // Speculations run the whole transactions, not along with DAG
+    auto speculative = !withDAG && speculativeExecutor() != nullptr;
+    m_scheduleMode = m_scheduler->m_dmtScheduleMode.load();
+    if (m_scheduleMode == DMTScheduleMode::ADAPTIVE && m_staticCall)
+    {
+        m_scheduleMode = DMTScheduleMode::LOCK_STEP;
+    }
+    else if (m_scheduleMode == DMTScheduleMode::ADAPTIVE)
+    {
+        ExecutionModeSelector::BlockFeatures features;
+        features.transactions = m_executiveStates.size();
+        features.contracts = m_contractQueues.size();
+        features.speculative = speculative;
+        for (auto& executiveState : m_executiveStates)
+        {
+            features.dagTransactions += executiveState.enableDAG ? 1 : 0;
+        }
+
+        auto choice = m_scheduler->m_executionModeSelector.choose(features);
+        m_scheduleMode = choice.mode;
+        SCHEDULER_LOG(DEBUG) << "Schedule mode chosen" << LOG_KV("block number", number())
+                             << LOG_KV("mode", static_cast<int>(choice.mode))
+                             << LOG_KV("reason", choice.reason)
+                             << LOG_KV("transactions", features.transactions)
+                             << LOG_KV("contracts", features.contracts)
+                             << LOG_KV("speculative", features.speculative)
+                             << LOG_KV("dagTransactions", features.dagTransactions);
+    }
+
+    // Serially in context order, the results of the speculations, whatever executors the node has
+    if (m_scheduleMode == DMTScheduleMode::OPTIMISTIC && !speculative)
+    {
+        m_scheduleMode = DMTScheduleMode::SERIAL;
+    }
+    if (m_scheduleMode == DMTScheduleMode::EVENT_DRIVEN && !m_staticCall &&
+        !m_scheduler->m_nondeterministicScheduleAllowed)
+    {
+        SCHEDULER_LOG(WARNING) << "Event driven mode depends on executor timing, the block "
+                                  "executes in lock step"
+                               << LOG_KV("block number", number());
+        m_scheduleMode = DMTScheduleMode::LOCK_STEP;
+    }
+    if (!m_staticCall)
+    {
+        m_scheduler->m_lastScheduleMode = m_scheduleMode;
+    }
+}
+
 void BlockExecutive::DAGExecute(std::function<void(Error::UniquePtr)> callback)
 {
-    std::multimap<std::string, decltype(m_executiveStates)::iterator> requests;
+    std::multimap<Interner::ContractID, ExecutiveState*> requests;
 
-    for (auto it = m_executiveStates.begin(); it != m_executiveStates.end(); ++it)
+    for (auto& executiveState : m_executiveStates)
     {
-        if (it->second.enableDAG)
+        if (executiveState.enableDAG)
         {
-            requests.emplace(std::get<0>(it->first), it);
+            requests.emplace(
+                m_interner->internContract(executiveState.message->to()), &executiveState);
         }
     }
 
@@ -387,69 +341,113 @@ void BlockExecutive::DAGExecute(std::function<void(Error::UniquePtr)> callback)
 
     for (auto it = requests.begin(); it != requests.end(); it = requests.upper_bound(it->first))
     {
-        SCHEDULER_LOG(TRACE) << "DAG contract: " << it->first;
+        auto contract = m_interner->contract(it->first);
+        SCHEDULER_LOG(TRACE) << "DAG contract: " << contract;
 
-        auto executor = m_scheduler->m_executorManager->dispatchExecutor(it->first);
+        auto executor = m_scheduler->m_executorManager->dispatchExecutor(contract);
         auto count = requests.count(it->first);
         auto range = requests.equal_range(it->first);
 
         auto messages = std::make_shared<std::vector<protocol::ExecutionMessage::UniquePtr>>(count);
-        auto iterators =
-            std::make_shared<std::vector<decltype(m_executiveStates)::iterator>>(count);
+        auto iterators = std::make_shared<std::vector<ExecutiveState*>>(count);
         size_t i = 0;
         for (auto messageIt = range.first; messageIt != range.second; ++messageIt)
         {
-            SCHEDULER_LOG(TRACE) << "message: " << messageIt->second->second.message.get()
-                                 << " to: " << messageIt->first;
-            messageIt->second->second.callStack.push(messageIt->second->second.currentSeq++);
-            messages->at(i) = std::move(messageIt->second->second.message);
-            iterators->at(i) = messageIt->second;
+            SCHEDULER_LOG(TRACE) << "message: " << messageIt->second->message.get()
+                                 << " to: " << contract;
+            auto* executiveState = messageIt->second;
+            executiveState->callStack.push_back(
+                {executiveState->currentSeq++, opensStaticFrame(*executiveState)});
+            messages->at(i) = std::move(executiveState->message);
+            iterators->at(i) = executiveState;
 
             ++i;
         }
 
-        executor->dagExecuteTransactions(*messages,
-            [messages, iterators, totalCount, failed, callbackPtr](bcos::Error::UniquePtr error,
-                std::vector<bcos::protocol::ExecutionMessage::UniquePtr> responseMessages) {
-                *totalCount -= responseMessages.size();
+        auto onResponse = [messages, iterators, totalCount, failed, callbackPtr](
+                              bcos::Error::UniquePtr error,
+                              std::vector<bcos::protocol::ExecutionMessage::UniquePtr>
+                                  responseMessages) {
+            auto left = (*totalCount -= messages->size());
 
-                if (error)
-                {
-                    ++(*failed);
-                    SCHEDULER_LOG(ERROR)
-                        << "DAG execute error: " << boost::diagnostic_information(*error);
-                }
-                else if (messages->size() != responseMessages.size())
+            if (error)
+            {
+                ++(*failed);
+                SCHEDULER_LOG(ERROR)
+                    << "DAG execute error: " << boost::diagnostic_information(*error);
+            }
+            else if (messages->size() != responseMessages.size())
+            {
+                ++(*failed);
+                SCHEDULER_LOG(ERROR) << "DAG messages mismatch!";
+            }
+            else
+            {
+                for (size_t i = 0; i < responseMessages.size(); ++i)
                 {
-                    ++(*failed);
-                    SCHEDULER_LOG(ERROR) << "DAG messages mismatch!";
+                    (*iterators)[i]->message = std::move(responseMessages[i]);
                 }
-                else
+            }
+
+            if (left == 0)
+            {
+                if (*failed > 0)
                 {
-                    for (size_t i = 0; i < responseMessages.size(); ++i)
-                    {
-                        (*iterators)[i]->second.message = std::move(responseMessages[i]);
-                    }
+                    (*callbackPtr)(BCOS_ERROR_UNIQUE_PTR(
+                        SchedulerError::DAGError, "Execute dag with errors"));
+                    return;
                 }
 
-                if (*totalCount == 0)
-                {
-                    if (*failed > 0)
-                    {
-                        (*callbackPtr)(BCOS_ERROR_UNIQUE_PTR(
-                            SchedulerError::DAGError, "Execute dag with errors"));
-                        return;
-                    }
+                (*callbackPtr)(nullptr);
+            }
+        };
 
-                    (*callbackPtr)(nullptr);
-                }
-            });
+        auto* executorRaw = executor.get();
+        whenExecutorReady(executorRaw, [executor = std::move(executor), messages,
+                                           onResponse = std::move(onResponse)](
+                                           const Error::Ptr& error) mutable {
+            if (error)
+            {
+                onResponse(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                               SchedulerError::NextBlockError, "Next block error!", *error),
+                    {});
+                return;
+            }
+
+            executor->dagExecuteTransactions(*messages, std::move(onResponse));
+        });
     }
 }
 
 void BlockExecutive::DMTExecute(
     std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback)
 {
+    if (m_scheduleMode == DMTScheduleMode::EVENT_DRIVEN ||
+        m_scheduleMode == DMTScheduleMode::SERIAL)
+    {
+        auto onExecuted = [this, callback = std::move(callback)](Error::UniquePtr error) {
+            if (error)
+            {
+                callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                             SchedulerError::DMTError, "Execute with errors", *error),
+                    nullptr);
+                return;
+            }
+
+            DMTFinish(std::move(callback));
+        };
+
+        if (m_scheduleMode == DMTScheduleMode::SERIAL)
+        {
+            serialExecute(std::move(onExecuted));
+        }
+        else
+        {
+            eventExecute(std::move(onExecuted));
+        }
+        return;
+    }
+
     startBatch([this, callback = std::move(callback)](Error::UniquePtr&& error) {
         auto recursionCallback = std::make_shared<std::function<void(Error::UniquePtr)>>();
 
@@ -463,7 +461,7 @@ void BlockExecutive::DMTExecute(
                 return;
             }
 
-            if (!m_executiveStates.empty())
+            if (m_unfinishedStates > 0)
             {
                 SCHEDULER_LOG(TRACE) << "Non empty states, continue startBatch";
 
@@ -472,100 +470,362 @@ void BlockExecutive::DMTExecute(
             else
             {
                 SCHEDULER_LOG(TRACE) << "Empty states, end";
-                auto now = std::chrono::system_clock::now();
-                m_executeElapsed =
-                    std::chrono::duration_cast<std::chrono::milliseconds>(now - m_currentTimePoint);
-                m_currentTimePoint = now;
+                DMTFinish(callback);
+            }
+        };
+
+        (*recursionCallback)(std::move(error));
+    });
+}
+
+bool BlockExecutive::prepareExecutiveStates()
+{
+    // Messages are independent, build them in parallel then index them in context order
+    std::vector<protocol::ExecutionMessage::UniquePtr> messages;
+    std::vector<uint8_t> dagFlags;
+    if (m_block->transactionsMetaDataSize() > 0)
+    {
+        SCHEDULER_LOG(DEBUG) << LOG_KV("block number", m_block->blockHeaderConst()->number())
+                             << LOG_KV("meta tx count", m_block->transactionsMetaDataSize());
 
-                if (m_staticCall)
+        auto count = m_block->transactionsMetaDataSize();
+        m_executiveResults.resize(count);
+        messages.resize(count);
+        dagFlags.resize(count);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, count),
+            [this, &messages, &dagFlags](const tbb::blocked_range<size_t>& range) {
+                for (auto i = range.begin(); i != range.end(); ++i)
                 {
-                    // Set result to m_block
-                    for (auto& it : m_executiveResults)
+                    auto metaData = m_block->transactionMetaData(i);
+
+                    auto message = m_scheduler->m_executionMessageFactory->createExecutionMessage();
+                    message->setContextID(i + m_startContextID);
+                    message->setType(protocol::ExecutionMessage::TXHASH);
+                    message->setTransactionHash(metaData->hash());
+
+                    if (metaData->attribute() &
+                        bcos::protocol::Transaction::Attribute::LIQUID_SCALE_CODEC)
                     {
-                        m_block->appendReceipt(it.receipt);
+                        // LIQUID
+                        if (metaData->attribute() &
+                            bcos::protocol::Transaction::Attribute::LIQUID_CREATE)
+                        {
+                            message->setCreate(true);
+                        }
+                        message->setTo(std::string(metaData->to()));
                     }
-                    callback(nullptr, nullptr);
-                }
-                else
-                {
-                    // All Transaction finished, get hash
-                    batchGetHashes([this, callback = std::move(callback)](
-                                       Error::UniquePtr error, crypto::HashType hash) {
-                        if (error)
+                    else
+                    {
+                        // SOLIDITY
+                        if (metaData->to().empty())
                         {
-                            callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
-                                         SchedulerError::UnknownError, "Unknown error", *error),
-                                nullptr);
-                            return;
+                            message->setCreate(true);
                         }
+                        else
+                        {
+                            message->setTo(preprocessAddress(metaData->to()));
+                        }
+                    }
+
+                    message->setDepth(0);
+                    message->setGasAvailable(TRANSACTION_GAS);
+                    message->setStaticCall(false);
+
+                    dagFlags[i] =
+                        (metaData->attribute() & bcos::protocol::Transaction::Attribute::DAG) != 0;
+                    messages[i] = std::move(message);
+
+                    if (metaData)
+                    {
+                        m_executiveResults[i].transactionHash = metaData->hash();
+                        m_executiveResults[i].source = metaData->source();
+                    }
+                }
+            });
+    }
+    else if (m_block->transactionsSize() > 0)
+    {
+        SCHEDULER_LOG(DEBUG) << LOG_KV("block number", m_block->blockHeaderConst()->number())
+                             << LOG_KV("tx count", m_block->transactionsSize());
+
+        // Native messages refer to the transaction input, others copy it
+        bool referInput = dynamic_cast<bcos::executor::NativeExecutionMessageFactory*>(
+                              m_scheduler->m_executionMessageFactory.get()) != nullptr;
+
+        auto count = m_block->transactionsSize();
+        m_executiveResults.resize(count);
+        messages.resize(count);
+        dagFlags.resize(count);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, count),
+            [this, referInput, &messages, &dagFlags](const tbb::blocked_range<size_t>& range) {
+                for (auto i = range.begin(); i != range.end(); ++i)
+                {
+                    auto tx = m_block->transaction(i);
+                    m_executiveResults[i].transactionHash = tx->hash();
+                    m_executiveResults[i].source = tx->source();
+
+                    protocol::ExecutionMessage::UniquePtr message;
+                    if (referInput)
+                    {
+                        m_inputReferencedBytes += tx->input().size();
+                        message = std::make_unique<TransactionInputMessage>(
+                            tx, m_scheduler->m_transactionInputStatistics);
+                    }
+                    else
+                    {
+                        message = m_scheduler->m_executionMessageFactory->createExecutionMessage();
+                        message->setData(tx->input().toBytes());
+                        m_inputCopiedBytes += tx->input().size();
+                    }
+                    message->setType(protocol::ExecutionMessage::MESSAGE);
+                    message->setContextID(i + m_startContextID);
 
-                        m_hashElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::system_clock::now() - m_currentTimePoint);
+                    message->setOrigin(toHex(tx->sender()));
+                    message->setFrom(std::string(message->origin()));
 
-                        // Set result to m_block
-                        for (auto& it : m_executiveResults)
+                    if (tx->attribute() &
+                        bcos::protocol::Transaction::Attribute::LIQUID_SCALE_CODEC)
+                    {
+                        // LIQUID
+                        if (tx->attribute() &
+                            bcos::protocol::Transaction::Attribute::LIQUID_CREATE)
                         {
-                            m_block->appendReceipt(it.receipt);
+                            message->setCreate(true);
                         }
-                        auto executedBlockHeader =
-                            m_blockFactory->blockHeaderFactory()->populateBlockHeader(
-                                m_block->blockHeader());
-                        executedBlockHeader->setStateRoot(hash);
-                        executedBlockHeader->setGasUsed(m_gasUsed);
-                        executedBlockHeader->setTxsRoot(m_block->calculateTransactionRoot());
-                        executedBlockHeader->setReceiptsRoot(m_block->calculateReceiptRoot());
-
-                        m_result = executedBlockHeader;
-                        callback(nullptr, m_result);
-                    });
+                        message->setTo(std::string(tx->to()));
+                    }
+                    else
+                    {
+                        // SOLIDITY
+                        if (tx->to().empty())
+                        {
+                            message->setCreate(true);
+                        }
+                        else
+                        {
+                            if (m_scheduler->m_isAuthCheck && !m_staticCall &&
+                                m_block->blockHeaderConst()->number() == 0 &&
+                                tx->to() == precompiled::AUTH_COMMITTEE_ADDRESS)
+                            {
+                                // if enable auth check, and first deploy auth contract
+                                message->setCreate(true);
+                            }
+                            message->setTo(preprocessAddress(tx->to()));
+                        }
+                    }
+
+                    message->setDepth(0);
+                    message->setGasAvailable(TRANSACTION_GAS);
+                    message->setStaticCall(m_staticCall);
+
+                    dagFlags[i] =
+                        (tx->attribute() & bcos::protocol::Transaction::Attribute::DAG) != 0;
+                    messages[i] = std::move(message);
                 }
-            }
-        };
+            });
+    }
 
-        (*recursionCallback)(std::move(error));
-    });
+    // A DAG transaction enables DAG for itself and every transaction after it
+    bool withDAG = false;
+    m_executiveStates.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        withDAG = withDAG || dagFlags[i];
+        enqueueExecutive(m_executiveStates.emplace_back(i, std::move(messages[i]), withDAG));
+    }
+
+    return withDAG;
 }
 
-void BlockExecutive::batchNextBlock(std::function<void(Error::UniquePtr)> callback)
+void BlockExecutive::DMTFinish(
+    std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback)
 {
-    auto status = std::make_shared<CommitStatus>();
-    status->total = m_scheduler->m_executorManager->size();
-    status->checkAndCommit = [this, callback = std::move(callback)](const CommitStatus& status) {
-        if (status.success + status.failed < status.total)
+    auto now = std::chrono::system_clock::now();
+    m_executeElapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - m_currentTimePoint);
+    m_currentTimePoint = now;
+
+    m_scheduler->m_blockArenaStatistics.record(m_arena);
+    m_scheduler->m_transactionInputStatistics->referencedBytes += m_inputReferencedBytes;
+    m_scheduler->m_transactionInputStatistics->copiedBytes += m_inputCopiedBytes;
+    if (m_scheduleMode == DMTScheduleMode::OPTIMISTIC)
+    {
+        m_scheduler->m_executionModeSelector.record(m_executiveStates.size(), m_conflicts);
+    }
+    SCHEDULER_LOG(DEBUG) << "Transaction input" << LOG_KV("referenced", m_inputReferencedBytes)
+                         << LOG_KV("copied", m_inputCopiedBytes);
+    m_scheduler->m_keyLockTransferStatistics.listBytes += m_keyLockListBytes;
+    m_scheduler->m_keyLockTransferStatistics.deltaBytes += m_keyLockDeltaBytes;
+    SCHEDULER_LOG(DEBUG) << "Key locks sent" << LOG_KV("listBytes", m_keyLockListBytes)
+                         << LOG_KV("deltaBytes", m_keyLockDeltaBytes);
+    SCHEDULER_LOG(DEBUG) << "Block arena" << LOG_KV("allocations", m_arena.allocations())
+                         << LOG_KV("bytes", m_arena.allocatedBytes())
+                         << LOG_KV("upstreamAllocations", m_arena.upstreamAllocations())
+                         << LOG_KV("upstreamBytes", m_arena.upstreamBytes());
+
+    if (m_staticCall)
+    {
+        // Set result to m_block
+        for (auto& it : m_executiveResults)
         {
-            return;
+            m_block->appendReceipt(it.receipt);
         }
+        callback(nullptr, nullptr);
+    }
+    else
+    {
+        // Hashes follow the block header on every executor
+        whenAllExecutorsReady([this, callback = std::move(callback)](const Error::Ptr& error) {
+            if (error)
+            {
+                callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                             SchedulerError::NextBlockError, "Next block error!", *error),
+                    nullptr);
+                return;
+            }
 
-        if (status.failed > 0)
-        {
-            auto message = "Next block:" + boost::lexical_cast<std::string>(number()) +
-                           " with errors! " + boost::lexical_cast<std::string>(status.failed);
-            SCHEDULER_LOG(ERROR) << message;
+            DMTGetHashes(std::move(callback));
+        });
+    }
+}
 
-            callback(BCOS_ERROR_UNIQUE_PTR(SchedulerError::UnknownError, std::move(message)));
+void BlockExecutive::DMTGetHashes(
+    std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback)
+{
+    // All Transaction finished, get hash
+    batchGetHashes([this, callback = std::move(callback)](
+                       Error::UniquePtr error, crypto::HashType hash) {
+        if (error)
+        {
+            callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                         SchedulerError::UnknownError, "Unknown error", *error),
+                nullptr);
             return;
         }
 
-        callback(nullptr);
-    };
+        m_hashElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now() - m_currentTimePoint);
 
-    for (auto& it : *(m_scheduler->m_executorManager))
-    {
-        SCHEDULER_LOG(TRACE) << "NextBlock for executor: " << it.get();
+        // Set result to m_block
+        for (auto& it : m_executiveResults)
+        {
+            m_block->appendReceipt(it.receipt);
+        }
+        auto executedBlockHeader =
+            m_blockFactory->blockHeaderFactory()->populateBlockHeader(m_block->blockHeader());
+        executedBlockHeader->setStateRoot(hash);
+        executedBlockHeader->setGasUsed(m_gasUsed);
+        executedBlockHeader->setTxsRoot(m_block->calculateTransactionRoot());
+        executedBlockHeader->setReceiptsRoot(m_block->calculateReceiptRoot());
+
+        m_result = executedBlockHeader;
+        callback(nullptr, m_result);
+    });
+}
+
+void BlockExecutive::batchNextBlock()
+{
+    // Every executor is waited for before the first header is sent, an acknowledgement may come at
+    // once
+    {
+        std::unique_lock<std::mutex> lock(m_executorReadinessMutex);
+        for (auto& it : *(m_scheduler->m_executorManager))
+        {
+            m_executorReadiness[it.get()];
+        }
+    }
+
+    for (auto& it : *(m_scheduler->m_executorManager))
+    {
+        SCHEDULER_LOG(TRACE) << "NextBlock for executor: " << it.get();
         auto blockHeader = m_block->blockHeaderConst();
-        it->nextBlockHeader(blockHeader, [status](bcos::Error::Ptr&& error) {
-            if (error)
+        it->nextBlockHeader(
+            blockHeader, [this, executor = it.get()](bcos::Error::Ptr&& error) {
+                if (error)
+                {
+                    SCHEDULER_LOG(ERROR) << "Next block: " << number() << " executor error! "
+                                         << boost::diagnostic_information(*error);
+                }
+
+                std::vector<std::function<void(const Error::Ptr&)>> pending;
+                {
+                    std::unique_lock<std::mutex> lock(m_executorReadinessMutex);
+                    auto& readiness = m_executorReadiness[executor];
+                    readiness.ready = true;
+                    readiness.error = error;
+                    pending.swap(readiness.pending);
+                }
+
+                for (auto& send : pending)
+                {
+                    send(error);
+                }
+            });
+    }
+}
+
+void BlockExecutive::whenExecutorReady(
+    bcos::executor::ParallelTransactionExecutorInterface* executor,
+    std::function<void(const Error::Ptr&)> send)
+{
+    Error::Ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_executorReadinessMutex);
+        auto it = m_executorReadiness.find(executor);
+        if (it != m_executorReadiness.end())
+        {
+            if (!it->second.ready)
             {
-                SCHEDULER_LOG(ERROR)
-                    << "Nextblock executor error!" << boost::diagnostic_information(*error);
-                ++status->failed;
+                it->second.pending.push_back(std::move(send));
+                return;
             }
-            else
+            error = it->second.error;
+        }
+    }
+
+    // Executors without a header sent are ready
+    send(error);
+}
+
+void BlockExecutive::whenAllExecutorsReady(std::function<void(const Error::Ptr&)> callback)
+{
+    std::vector<bcos::executor::ParallelTransactionExecutorInterface*> executors;
+    {
+        std::unique_lock<std::mutex> lock(m_executorReadinessMutex);
+        for (auto& it : m_executorReadiness)
+        {
+            executors.push_back(it.first);
+        }
+    }
+    if (executors.empty())
+    {
+        callback(nullptr);
+        return;
+    }
+
+    struct Status
+    {
+        std::atomic_size_t left;
+        std::mutex mutex;
+        Error::Ptr error;
+        std::function<void(const Error::Ptr&)> callback;
+    };
+    auto status = std::make_shared<Status>();
+    status->left = executors.size();
+    status->callback = std::move(callback);
+    for (auto* executor : executors)
+    {
+        whenExecutorReady(executor, [status](const Error::Ptr& error) {
+            if (error)
             {
-                ++status->success;
+                std::unique_lock<std::mutex> lock(status->mutex);
+                status->error = error;
             }
 
-            status->checkAndCommit(*status);
+            if (--status->left == 0)
+            {
+                status->callback(status->error);
+            }
         });
     }
 }
@@ -750,327 +1010,1387 @@ void BlockExecutive::startBatch(std::function<void(Error::UniquePtr)> callback)
     auto batchStatus = std::make_shared<BatchStatus>();
     batchStatus->callback = std::move(callback);
 
-    traverseExecutive([this, &batchStatus, calledContract = std::set<std::string, std::less<>>()](
-                          ExecutiveState& executiveState) mutable {
-        if (executiveState.error)
+    // Messages to dispatch, one writing message or a window of read only ones per contract
+    std::vector<ContractInflight> inflights;
+    dispatchRunnable(inflights, batchStatus->states, dispatchLimit(0));
+
+    batchStatus->total = batchStatus->states.size();
+    sendMessages(batchStatus->states, [this, batchStatus](ExecutiveState& executiveState,
+                                          bcos::Error::UniquePtr error,
+                                          bcos::protocol::ExecutionMessage::UniquePtr response) {
+        if (error)
         {
-            batchStatus->allSended = true;
+            SCHEDULER_LOG(ERROR) << "Execute transaction error: "
+                                 << boost::diagnostic_information(*error);
+
+            executiveState.error = std::move(error);
+            executiveState.message.reset();
+
+            // Set error to batch
             ++batchStatus->error;
+        }
+        else if (!response)
+        {
+            SCHEDULER_LOG(ERROR) << "Execute transaction with null response!";
 
-            SCHEDULER_LOG(TRACE) << "Detected error!";
-            return END;
+            ++batchStatus->error;
+        }
+        else
+        {
+            executiveState.message = std::move(response);
         }
 
-        auto& message = executiveState.message;
+        SCHEDULER_LOG(TRACE) << "Execute is finished!";
 
-        assert(message);
+        ++batchStatus->received;
+        checkBatch(*batchStatus);
+    });
 
-        auto contextID = executiveState.contextID;
-        auto seq = message->seq();
+    batchStatus->allSended = true;
+    checkBatch(*batchStatus);
+}
 
-        // Check if another context processing same contract
-        auto contractIt = calledContract.end();
-        if (!message->to().empty())
+void BlockExecutive::checkBatch(BatchStatus& status)
+{
+    SCHEDULER_LOG(TRACE) << "status: " << status.allSended << " " << status.received << " "
+                         << status.total;
+    if (status.allSended && status.received == status.total)
+    {
+        bool expect = false;
+        if (status.callbackExecuted.compare_exchange_strong(expect, true))  // Run callback once
         {
-            contractIt = calledContract.lower_bound(message->to());
-            if (contractIt != calledContract.end() && *contractIt == message->to())
+            SCHEDULER_LOG(TRACE) << "Enter checkBatch callback: " << status.total << " "
+                                 << status.received << " " << std::this_thread::get_id() << " "
+                                 << status.callbackExecuted;
+
+            SCHEDULER_LOG(TRACE) << "Batch run finished"
+                                 << " total: " << status.total << " error: " << status.error;
+
+            for (auto* executiveState : status.states)
             {
-                SCHEDULER_LOG(TRACE)
-                    << "Skip, " << contextID << " | " << seq << " | " << message->to();
-                executiveState.skip = true;
-                return SKIP;
+                executiveState->executingContract.reset();
             }
-        }
 
-        switch (message->type())
-        {
-        // Request type, push stack
-        case protocol::ExecutionMessage::MESSAGE:
-        case protocol::ExecutionMessage::TXHASH:
-        {
-            auto newSeq = executiveState.currentSeq++;
-            if (message->to().empty())
+            if (status.error > 0)
+            {
+                status.callback(
+                    BCOS_ERROR_UNIQUE_PTR(SchedulerError::BatchError, "Batch with errors"));
+                return;
+            }
+
+            if (m_unfinishedStates > 0 && status.total == 0)
+            {
+                SCHEDULER_LOG(INFO)
+                    << "No transaction executed this batch, start processing dead lock";
+
+                revertDeadLockVictims();
+                wakeWaitingExecutives();
+            }
+            else
             {
-                if (message->createSalt())
+                // Process key locks & queue the messages, the acquired keys of the whole batch are
+                // locked in one call after releasing
+                std::vector<GraphKeyLocks::KeyLockRequest> requests;
+                bool released = false;
+                for (auto* executiveState : status.states)
                 {
-                    message->setTo(
-                        newEVMAddress(message->from(), message->data(), *(message->createSalt())));
+                    released |= updateKeyLocks(*executiveState, requests);
                 }
-                else
+
+                if (auto error = acquireBatchKeyLocks(requests))
                 {
-                    message->setTo(newEVMAddress(number(), contextID, newSeq));
+                    status.callback(std::move(error));
+                    return;
                 }
-            }
-            executiveState.callStack.push(newSeq);
-            executiveState.message->setSeq(newSeq);
 
-            SCHEDULER_LOG(TRACE) << "Execute, " << message->contextID() << " | " << message->seq()
-                                 << " | " << std::hex << message->transactionHash() << " | "
-                                 << message->to();
+                for (auto* executiveState : status.states)
+                {
+                    enqueueExecutive(*executiveState);
+                }
+                if (released)
+                {
+                    wakeWaitingExecutives();
+                }
+            }
 
-            break;
+            status.callback(nullptr);
         }
-        // Return type, pop stack
-        case protocol::ExecutionMessage::FINISHED:
-        case protocol::ExecutionMessage::REVERT:
+    }
+}
+
+void BlockExecutive::eventExecute(std::function<void(Error::UniquePtr)> callback)
+{
+    SCHEDULER_LOG(TRACE) << "Start event driven execute";
+    auto status = std::make_shared<EventStatus>();
+    status->callback = std::move(callback);
+    status->draining = true;
+
+    drainEvents(status);
+}
+
+void BlockExecutive::drainEvents(const std::shared_ptr<EventStatus>& status)
+{
+    std::vector<EventStatus::Response> responses;
+    std::vector<GraphKeyLocks::KeyLockRequest> requests;
+    std::vector<ExecutiveState*> returns;
+    std::vector<ExecutiveState*> sends;
+
+    while (true)
+    {
+        bool released = false;
+        for (auto& response : responses)
         {
-            executiveState.callStack.pop();
+            auto& executiveState = *response.executiveState;
+            --status->inflights[*executiveState.executingContract].count;
+            executiveState.executingContract.reset();
+            --status->executing;
 
-            // Empty stack, execution is finished
-            if (executiveState.callStack.empty())
+            if (response.error)
             {
-                m_executiveResults[executiveState.contextID].receipt =
-                    m_scheduler->m_blockFactory->receiptFactory()->createReceipt(
-                        message->gasAvailable(), message->newEVMContractAddress(),
-                        std::make_shared<std::vector<bcos::protocol::LogEntry>>(
-                            message->takeLogEntries()),
-                        message->status(), message->takeData(),
-                        m_block->blockHeaderConst()->number());
-
-                // Calc the gas
-                m_gasUsed += (TRANSACTION_GAS - message->gasAvailable());
-
-                // Remove executive state and continue
-                SCHEDULER_LOG(TRACE)
-                    << "Eraseing, " << message->contextID() << " | " << message->seq() << " | "
-                    << std::hex << message->transactionHash() << " | " << message->to();
+                SCHEDULER_LOG(ERROR) << "Execute transaction error: "
+                                     << boost::diagnostic_information(*response.error);
 
-                return DELETE;
+                executiveState.error = std::move(response.error);
+                ++status->error;
+                continue;
             }
+            if (!response.message)
+            {
+                SCHEDULER_LOG(ERROR) << "Execute transaction with null response!";
 
-            message->setSeq(executiveState.callStack.top());
-            message->setCreate(false);
-
-            SCHEDULER_LOG(TRACE) << "FINISHED/REVERT, " << message->contextID() << " | "
-                                 << message->seq() << " | " << std::hex
-                                 << message->transactionHash() << " | " << message->to();
+                ++status->error;
+                continue;
+            }
 
-            break;
+            executiveState.message = std::move(response.message);
+            released |= updateKeyLocks(executiveState, requests);
+            returns.push_back(&executiveState);
         }
-        case protocol::ExecutionMessage::REVERT_KEY_LOCK:
-        {
-            message->setType(protocol::ExecutionMessage::REVERT);
-            message->setCreate(false);
-            message->setKeyLocks({});
-            SCHEDULER_LOG(TRACE) << "REVERT By key lock, " << message->contextID() << " | "
-                                 << message->seq() << " | " << std::hex
-                                 << message->transactionHash() << " | " << message->to();
+        responses.clear();
 
-            break;
+        if (!requests.empty())
+        {
+            if (acquireBatchKeyLocks(requests))
+            {
+                ++status->error;
+            }
+            requests.clear();
         }
-        // Retry type, send again
-        case protocol::ExecutionMessage::KEY_LOCK:
+
+        // Stop dispatching after errors, wait for the executing messages
+        if (status->error == 0)
         {
-            // Try acquire key lock
-            if (!m_keyLocks.acquireKeyLock(
-                    message->from(), message->keyLockAcquired(), contextID, seq))
+            for (auto* executiveState : returns)
             {
-                SCHEDULER_LOG(TRACE)
-                    << "Waiting key, contract: " << contextID << " | " << seq << " | "
-                    << message->from() << " keyLockAcquired: " << toHex(message->keyLockAcquired());
-                return PASS;
+                enqueueExecutive(*executiveState);
+            }
+            if (released)
+            {
+                wakeWaitingExecutives();
             }
 
-            SCHEDULER_LOG(TRACE) << "Wait key lock success, " << contextID << " | " << seq << " | "
-                                 << message->from()
-                                 << " keyLockAcquired: " << toHex(message->keyLockAcquired());
-            break;
+            dispatchRunnable(status->inflights, sends, dispatchLimit(status->executing));
         }
-        // Retry type, send again
-        case protocol::ExecutionMessage::SEND_BACK:
-        {
-            SCHEDULER_LOG(TRACE) << "Send back, " << contextID << " | " << seq << " | "
-                                 << message->transactionHash();
+        returns.clear();
 
-            if (message->transactionHash() != h256(0))
+        if (sends.empty() && status->executing == 0)
+        {
+            if (status->error > 0)
             {
-                message->setType(protocol::ExecutionMessage::TXHASH);
+                status->callback(BCOS_ERROR_UNIQUE_PTR(
+                    SchedulerError::BatchError, "Execute messages with errors"));
+                return;
             }
-            else
+
+            if (m_unfinishedStates == 0)
             {
-                message->setType(protocol::ExecutionMessage::MESSAGE);
+                SCHEDULER_LOG(TRACE) << "Empty states, end";
+                status->callback(nullptr);
+                return;
             }
 
-            if (message->to().empty())
+            // No response is coming to release a key lock, retry the waiting messages and break
+            // the dead locks if none can go
+            wakeWaitingExecutives();
+            dispatchRunnable(status->inflights, sends, dispatchLimit(status->executing));
+            if (sends.empty())
             {
-                if (message->createSalt())
-                {
-                    message->setTo(
-                        newEVMAddress(message->from(), message->data(), *(message->createSalt())));
-                }
-                else
+                SCHEDULER_LOG(INFO) << "No transaction executing, start processing dead lock";
+
+                if (revertDeadLockVictims() == 0)
                 {
-                    message->setTo(newEVMAddress(number(), contextID, seq));
+                    status->callback(BCOS_ERROR_UNIQUE_PTR(
+                        SchedulerError::UnexpectedKeyLockError, "No message can be executed"));
+                    return;
                 }
+                wakeWaitingExecutives();
+                dispatchRunnable(status->inflights, sends, dispatchLimit(status->executing));
             }
+        }
 
-            break;
+        sendEvents(status, sends);
+
+        std::unique_lock<std::mutex> lock(status->mutex);
+        if (status->responses.empty())
+        {
+            status->draining = false;
+            return;
         }
+        responses.swap(status->responses);
+    }
+}
+
+void BlockExecutive::dispatchRunnable(std::vector<ContractInflight>& inflights,
+    std::vector<ExecutiveState*>& sends, size_t limit)
+{
+    auto runnableContracts = std::move(m_runnableContracts);
+    m_runnableContracts.clear();
+    sortRunnable(runnableContracts);
+
+    for (auto contractID : runnableContracts)
+    {
+        auto& queue = m_contractQueues[contractID];
+        queue.runnable = false;
+        if (sends.size() < limit)
+        {
+            dispatchContract(contractID, inflights, sends, limit);
         }
 
-        calledContract.emplace_hint(contractIt, message->to());
+        if (!queue.ready.empty())
+        {
+            markRunnable(contractID);
+        }
+    }
+}
 
-        // Set current key lock into message
-        auto keyLocks = m_keyLocks.getKeyLocksNotHoldingByContext(message->to(), contextID);
-        message->setKeyLocks(std::move(keyLocks));
+void BlockExecutive::dispatchContract(Interner::ContractID contractID,
+    std::vector<ContractInflight>& inflights, std::vector<ExecutiveState*>& sends, size_t limit)
+{
+    // Ready messages are sent in context order while the contract admits them, a writing message
+    // executes alone, read only ones or declared writers share the contract up to the window
+    auto window = std::max<size_t>(m_scheduler->m_contractInflightWindow, 1);
+    auto& queue = m_contractQueues[contractID];
+    while (!queue.ready.empty() && sends.size() < limit)
+    {
+        auto& executiveState = m_executiveStates[queue.ready.top()];
+        declareKeyLocks(executiveState);
+        if (contractID < inflights.size() &&
+            !inflights[contractID].admits(nextAccess(executiveState), window))
+        {
+            return;
+        }
+        queue.ready.pop();
 
-        if (c_fileLogLevel >= bcos::LogLevel::TRACE)
+        switch (prepareMessage(executiveState))
         {
-            for (auto& keyIt : message->keyLocks())
+        case MessageHint::FINISH:
+        {
+            --m_unfinishedStates;
+            continue;
+        }
+        case MessageHint::WAIT:
+        {
+            if (queue.waiting.empty())
             {
-                SCHEDULER_LOG(TRACE)
-                    << boost::format(
-                           "Dispatch key lock type: %s, from: %s, to: %s, key: %s, "
-                           "contextID: %ld, seq: %ld") %
-                           message->type() % message->from() % message->to() % toHex(keyIt) %
-                           contextID % message->seq();
+                m_waitingContracts.push_back(contractID);
             }
+            queue.waiting.push_back(executiveState.contextID);
+            continue;
+        }
+        case MessageHint::SEND:
+            break;
         }
 
-        ++batchStatus->total;
-        auto executor = m_scheduler->m_executorManager->dispatchExecutor(message->to());
-
-        auto executeCallback = [this, &executiveState, batchStatus](bcos::Error::UniquePtr error,
-                                   bcos::protocol::ExecutionMessage::UniquePtr response) {
-            if (error)
-            {
-                SCHEDULER_LOG(ERROR)
-                    << "Execute transaction error: " << boost::diagnostic_information(*error);
+        // Messages creating contracts are queued with an empty address, each goes to a new one
+        auto targetContractID = m_interner->internContract(executiveState.message->to());
+        if (targetContractID >= inflights.size())
+        {
+            inflights.resize(targetContractID + 1);
+        }
+        auto& inflight = inflights[targetContractID];
+        ++inflight.count;
+        inflight.access = access(executiveState);
+        executiveState.executingContract = targetContractID;
+        sends.push_back(&executiveState);
+    }
+}
 
-                executiveState.error = std::move(error);
-                executiveState.message.reset();
+size_t BlockExecutive::dispatchLimit(size_t executing) const
+{
+    size_t limit = m_scheduler->m_dmtInflightLimit;
+    if (limit == 0)
+    {
+        return std::numeric_limits<size_t>::max();
+    }
+    return limit > executing ? limit - executing : 0;
+}
 
-                // Set error to batch
-                ++batchStatus->error;
-            }
-            else if (!response)
-            {
-                SCHEDULER_LOG(ERROR) << "Execute transaction with null response!";
+void BlockExecutive::sortRunnable(std::vector<Interner::ContractID>& contracts)
+{
+    if (m_scheduler->m_dmtDispatchOrder != DMTDispatchOrder::CRITICAL_PATH)
+    {
+        std::sort(contracts.begin(), contracts.end());
+        return;
+    }
 
-                ++batchStatus->error;
-            }
-            else
-            {
-                executiveState.message = std::move(response);
-            }
+    // The contract with the most pending messages bounds the end of the block, it goes first.
+    // Only the block decides the order, execution times would differ between nodes
+    std::vector<std::tuple<int64_t, Interner::ContractID>> works;
+    works.reserve(contracts.size());
+    for (auto contractID : contracts)
+    {
+        auto& queue = m_contractQueues[contractID];
+        works.emplace_back(
+            -static_cast<int64_t>(queue.ready.size() + queue.waiting.size()), contractID);
+    }
+    std::sort(works.begin(), works.end());
 
-            SCHEDULER_LOG(TRACE) << "Execute is finished!";
+    for (size_t i = 0; i < works.size(); ++i)
+    {
+        contracts[i] = std::get<1>(works[i]);
+    }
+}
 
-            ++batchStatus->received;
-            checkBatch(*batchStatus);
-        };
+void BlockExecutive::sendEvents(
+    const std::shared_ptr<EventStatus>& status, std::vector<ExecutiveState*>& sends)
+{
+    if (sends.empty())
+    {
+        return;
+    }
 
-        if (executiveState.message->staticCall())
-        {
-            executor->call(std::move(executiveState.message), std::move(executeCallback));
-        }
-        else
+    status->executing += sends.size();
+    sendMessages(sends, [this, status](ExecutiveState& executiveState, Error::UniquePtr error,
+                            protocol::ExecutionMessage::UniquePtr response) {
         {
-            executor->executeTransaction(
-                std::move(executiveState.message), std::move(executeCallback));
+            std::unique_lock<std::mutex> lock(status->mutex);
+            status->responses.push_back(
+                EventStatus::Response{&executiveState, std::move(error), std::move(response)});
+            if (status->draining)
+            {
+                return;
+            }
+            status->draining = true;
         }
 
-        return PASS;
+        drainEvents(status);
     });
-
-    batchStatus->allSended = true;
-    checkBatch(*batchStatus);
+    sends.clear();
 }
 
-void BlockExecutive::checkBatch(BatchStatus& status)
+bcos::executor::ParallelTransactionExecutorInterface::Ptr BlockExecutive::speculativeExecutor()
 {
-    SCHEDULER_LOG(TRACE) << "status: " << status.allSended << " " << status.received << " "
-                         << status.total;
-    if (status.allSended && status.received == status.total)
+    // A speculation runs the whole transaction, every contract has to be on the executor
+    if (m_staticCall || m_scheduler->m_executorManager->size() != 1)
     {
-        bool expect = false;
-        if (status.callbackExecuted.compare_exchange_strong(expect, true))  // Run callback once
-        {
-            SCHEDULER_LOG(TRACE) << "Enter checkBatch callback: " << status.total << " "
-                                 << status.received << " " << std::this_thread::get_id() << " "
-                                 << status.callbackExecuted;
+        return nullptr;
+    }
 
-            SCHEDULER_LOG(TRACE) << "Batch run finished"
-                                 << " total: " << status.total << " error: " << status.error;
+    auto executor = *(m_scheduler->m_executorManager->begin());
+    if (dynamic_cast<SpeculativeExecutorInterface*>(executor.get()) == nullptr)
+    {
+        return nullptr;
+    }
+    return executor;
+}
 
-            if (status.error > 0)
+void BlockExecutive::optimisticExecute(
+    bcos::executor::ParallelTransactionExecutorInterface::Ptr executor,
+    std::function<void(Error::UniquePtr)> callback)
+{
+    SCHEDULER_LOG(TRACE) << "Start optimistic execute";
+    if (m_executiveStates.empty())
+    {
+        callback(nullptr);
+        return;
+    }
+
+    auto status = std::make_shared<OptimisticStatus>();
+    status->speculativeExecutor = dynamic_cast<SpeculativeExecutorInterface*>(executor.get());
+    status->executor = std::move(executor);
+    status->contexts.resize(m_executiveStates.size());
+    status->callback = std::move(callback);
+
+    whenExecutorReady(status->executor.get(), [this, status](const Error::Ptr& error) {
+        if (error)
+        {
+            status->callback(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                SchedulerError::NextBlockError, "Next block error!", *error));
+            return;
+        }
+
+        // Every transaction is speculated against the state before the block at first
+        std::vector<protocol::ExecutionMessage::UniquePtr> inputs;
+        std::vector<size_t> contexts;
+        inputs.reserve(m_executiveStates.size());
+        contexts.reserve(m_executiveStates.size());
+        for (auto& executiveState : m_executiveStates)
+        {
+            inputs.push_back(std::move(executiveState.message));
+            contexts.push_back(executiveState.contextID);
+        }
+
+        status->speculativeExecutor->speculateTransactions(std::move(inputs),
+            [this, status, contexts = std::move(contexts)](Error::UniquePtr error,
+                std::vector<SpeculativeExecutorInterface::Speculation> speculations) mutable {
+                onSpeculations(
+                    status, std::move(contexts), std::move(error), std::move(speculations));
+            });
+    });
+}
+
+void BlockExecutive::onSpeculations(const std::shared_ptr<OptimisticStatus>& status,
+    std::vector<size_t> contexts, Error::UniquePtr error,
+    std::vector<SpeculativeExecutorInterface::Speculation> speculations)
+{
+    if (!error && speculations.size() != contexts.size())
+    {
+        error = BCOS_ERROR_UNIQUE_PTR(SchedulerError::SpeculationError,
+            "Speculations: " + boost::lexical_cast<std::string>(speculations.size()) +
+                " mismatch transactions: " + boost::lexical_cast<std::string>(contexts.size()));
+    }
+    if (!error && std::any_of(speculations.begin(), speculations.end(),
+                      [](const auto& speculation) { return !speculation.message; }))
+    {
+        error = BCOS_ERROR_UNIQUE_PTR(
+            SchedulerError::SpeculationError, "Speculation with null message!");
+    }
+    if (error)
+    {
+        SCHEDULER_LOG(ERROR) << "Speculate transactions error: "
+                             << boost::diagnostic_information(*error);
+        status->callback(std::move(error));
+        return;
+    }
+
+    ++status->rounds;
+    status->speculations += speculations.size();
+    for (size_t i = 0; i < contexts.size(); ++i)
+    {
+        auto& context = status->contexts[contexts[i]];
+        context.speculation = std::move(speculations[i]);
+        context.base = status->applied;
+    }
+
+    std::vector<size_t> applies;
+    std::vector<size_t> speculates;
+    validateSpeculations(*status, applies, speculates);
+    SCHEDULER_LOG(TRACE) << "Speculations validated" << LOG_KV("round", status->rounds)
+                         << LOG_KV("applies", applies.size())
+                         << LOG_KV("speculates", speculates.size());
+
+    auto toContextIDs = [this](const std::vector<size_t>& contexts) {
+        std::vector<ContextID> contextIDs;
+        contextIDs.reserve(contexts.size());
+        for (auto context : contexts)
+        {
+            contextIDs.push_back(context + m_startContextID);
+        }
+        return contextIDs;
+    };
+
+    // The next round speculates against the state with the applied contexts
+    auto next = [this, status, toContextIDs, speculates = std::move(speculates)](
+                    Error::UniquePtr error) mutable {
+        if (error)
+        {
+            SCHEDULER_LOG(ERROR) << "Apply speculations error: "
+                                 << boost::diagnostic_information(*error);
+            status->callback(std::move(error));
+            return;
+        }
+
+        // No context to speculate again is left once every context is applied
+        if (speculates.empty())
+        {
+            m_conflicts += status->speculations - status->contexts.size();
+            SCHEDULER_LOG(DEBUG) << "Optimistic execute finished"
+                                 << LOG_KV("transactions", status->contexts.size())
+                                 << LOG_KV("rounds", status->rounds)
+                                 << LOG_KV("speculations", status->speculations);
+            status->callback(nullptr);
+            return;
+        }
+
+        auto contextIDs = toContextIDs(speculates);
+        status->speculativeExecutor->respeculateTransactions(std::move(contextIDs),
+            [this, status, speculates = std::move(speculates)](Error::UniquePtr error,
+                std::vector<SpeculativeExecutorInterface::Speculation> speculations) mutable {
+                onSpeculations(
+                    status, std::move(speculates), std::move(error), std::move(speculations));
+            });
+    };
+
+    if (applies.empty())
+    {
+        next(nullptr);
+        return;
+    }
+    status->speculativeExecutor->applySpeculations(toContextIDs(applies), std::move(next));
+}
+
+void BlockExecutive::validateSpeculations(
+    OptimisticStatus& status, std::vector<size_t>& applies, std::vector<size_t>& speculates)
+{
+    // A speculation is valid if no context applied since it was taken wrote a key it read. Contexts
+    // after the first invalid one wait for it, an invalid one is speculated again at once unless it
+    // read keys written by the waiting contexts before it, a new speculation would read them stale
+    bool blocked = false;
+    std::unordered_set<std::string_view> pendingWrites;  // Of the waiting contexts passed
+    for (auto i = status.applied; i < status.contexts.size(); ++i)
+    {
+        auto& context = status.contexts[i];
+        auto& speculation = context.speculation;
+        auto stale = std::any_of(speculation.reads.begin(), speculation.reads.end(),
+            [&status, &context](const std::string& key) {
+                auto it = status.lastWriters.find(key);
+                return it != status.lastWriters.end() && it->second >= context.base;
+            });
+
+        if (!blocked && !stale)
+        {
+            for (auto& key : speculation.writes)
             {
-                status.callback(
-                    BCOS_ERROR_UNIQUE_PTR(SchedulerError::BatchError, "Batch with errors"));
+                status.lastWriters[key] = i;
+            }
+            finishExecutive(m_executiveStates[i], *speculation.message);
+            --m_unfinishedStates;
+            speculation = {};
+
+            applies.push_back(i);
+            status.applied = i + 1;
+            continue;
+        }
+
+        if (!blocked)
+        {
+            blocked = true;
+            speculates.push_back(i);
+        }
+        else if (stale && std::none_of(speculation.reads.begin(), speculation.reads.end(),
+                              [&pendingWrites](const std::string& key) {
+                                  return pendingWrites.count(key) > 0;
+                              }))
+        {
+            speculates.push_back(i);
+        }
+        pendingWrites.insert(speculation.writes.begin(), speculation.writes.end());
+    }
+}
+
+void BlockExecutive::serialExecute(std::function<void(Error::UniquePtr)> callback)
+{
+    SCHEDULER_LOG(TRACE) << "Start serial execute";
+    auto status = std::make_shared<SerialStatus>();
+    status->callback = std::move(callback);
+
+    serialLoop(status);
+}
+
+void BlockExecutive::serialLoop(const std::shared_ptr<SerialStatus>& status)
+{
+    // A response arriving within the send call is taken by this loop instead of a nested one
+    while (true)
+    {
+        if (status->context == m_executiveStates.size())
+        {
+            status->callback(nullptr);
+            return;
+        }
+
+        auto& executiveState = m_executiveStates[status->context];
+        if (executiveState.error)
+        {
+            status->callback(std::move(executiveState.error));
+            return;
+        }
+
+        // Nothing else executes, so the key a KEY_LOCK asks for is not held by others and the
+        // message is sent on without key locks. An executor asking again would do so forever
+        auto& message = executiveState.message;
+        if (message->type() == protocol::ExecutionMessage::KEY_LOCK)
+        {
+            if (status->keyLockSent)
+            {
+                SCHEDULER_LOG(ERROR) << "Serial execute repeated key lock, " << status->context
+                                     << " | " << message->from()
+                                     << " keyLockAcquired: " << toHex(message->keyLockAcquired());
+                status->callback(BCOS_ERROR_UNIQUE_PTR(
+                    SchedulerError::DMTError, "Serial execute repeated key lock!"));
                 return;
             }
+            status->keyLockSent = true;
+        }
+        else if (prepareMessage(executiveState) == MessageHint::FINISH)
+        {
+            --m_unfinishedStates;
+            ++status->context;
+            status->keyLockSent = false;
+            continue;
+        }
+        if (!message->keyLocks().empty())
+        {
+            message->setKeyLocks({});
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(status->mutex);
+            status->sending = true;
+            status->responded = false;
+        }
+
+        auto executor = m_scheduler->m_executorManager->dispatchExecutor(message->to());
+        auto* executorRaw = executor.get();
+        whenExecutorReady(executorRaw, [this, status, &executiveState,
+                                           executor = std::move(executor)](
+                                           const Error::Ptr& error) {
+            auto onResponse = [this, status, &executiveState](bcos::Error::UniquePtr error,
+                                  bcos::protocol::ExecutionMessage::UniquePtr response) {
+                if (error)
+                {
+                    SCHEDULER_LOG(ERROR) << "Execute transaction error: "
+                                         << boost::diagnostic_information(*error);
+                    executiveState.error = std::move(error);
+                }
+                else if (!response)
+                {
+                    SCHEDULER_LOG(ERROR) << "Execute transaction with null response!";
+                    executiveState.error = BCOS_ERROR_UNIQUE_PTR(
+                        SchedulerError::DMTError, "Execute transaction with null response!");
+                }
+                else
+                {
+                    executiveState.message = std::move(response);
+                }
 
-            if (!m_executiveStates.empty() && status.total == 0)
+                bool resume = false;
+                {
+                    std::unique_lock<std::mutex> lock(status->mutex);
+                    status->responded = true;
+                    resume = !status->sending;
+                }
+                if (resume)
+                {
+                    serialLoop(status);
+                }
+            };
+
+            if (error)
             {
-                SCHEDULER_LOG(INFO)
-                    << "No transaction executed this batch, start processing dead lock";
+                onResponse(BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                               SchedulerError::NextBlockError, "Next block error!", *error),
+                    nullptr);
+                return;
+            }
 
-                traverseExecutive([this](ExecutiveState& executiveState) {
-                    if (executiveState.skip)
-                    {
-                        executiveState.skip = false;
-                        return SKIP;
-                    }
+            if (executiveState.message->staticCall())
+            {
+                executor->call(std::move(executiveState.message), std::move(onResponse));
+            }
+            else
+            {
+                executor->executeTransaction(
+                    std::move(executiveState.message), std::move(onResponse));
+            }
+        });
 
-                    if (m_keyLocks.detectDeadLock(executiveState.contextID))
-                    {
-                        SCHEDULER_LOG(INFO)
-                            << "Detected dead lock at " << executiveState.contextID << " | "
-                            << executiveState.message->seq() << " , revert";
+        std::unique_lock<std::mutex> lock(status->mutex);
+        status->sending = false;
+        if (!status->responded)
+        {
+            return;
+        }
+    }
+}
 
-                        executiveState.message->setType(
-                            bcos::protocol::ExecutionMessage::REVERT_KEY_LOCK);
-                        return END;
-                    }
-                    return PASS;
-                });
+GraphKeyLocks::KeyLockMode BlockExecutive::keyLockMode(const ExecutiveState& executiveState)
+{
+    return !executiveState.callStack.empty() && executiveState.callStack.back().staticCall ?
+               GraphKeyLocks::KeyLockMode::SHARED :
+               GraphKeyLocks::KeyLockMode::EXCLUSIVE;
+}
+
+GraphKeyLocks::KeyLockMode BlockExecutive::nextKeyLockMode(const ExecutiveState& executiveState)
+{
+    auto& callStack = executiveState.callStack;
+    switch (executiveState.message->type())
+    {
+    case protocol::ExecutionMessage::MESSAGE:
+    case protocol::ExecutionMessage::TXHASH:
+        return opensStaticFrame(executiveState) ? GraphKeyLocks::KeyLockMode::SHARED :
+                                                  GraphKeyLocks::KeyLockMode::EXCLUSIVE;
+    case protocol::ExecutionMessage::FINISHED:
+    case protocol::ExecutionMessage::REVERT:
+        // The static flag of a return is the callee's, the caller holds its own keys
+        if (callStack.size() > 1)
+        {
+            return callStack[callStack.size() - 2].staticCall ?
+                       GraphKeyLocks::KeyLockMode::SHARED :
+                       GraphKeyLocks::KeyLockMode::EXCLUSIVE;
+        }
+        return keyLockMode(executiveState);
+    default:
+        return keyLockMode(executiveState);
+    }
+}
+
+bool BlockExecutive::opensStaticFrame(const ExecutiveState& executiveState)
+{
+    return executiveState.message->staticCall() ||
+           (!executiveState.callStack.empty() && executiveState.callStack.back().staticCall);
+}
+
+bool BlockExecutive::opensDeclaredFrame(const ExecutiveState& executiveState)
+{
+    return executiveState.callStack.empty() && executiveState.declaredKeyLocks &&
+           !opensStaticFrame(executiveState);
+}
+
+BlockExecutive::ContractInflight::Access BlockExecutive::access(
+    const ExecutiveState& executiveState)
+{
+    if (keyLockMode(executiveState) == GraphKeyLocks::KeyLockMode::SHARED)
+    {
+        return ContractInflight::Access::READ;
+    }
+    return !executiveState.callStack.empty() && executiveState.callStack.back().declared ?
+               ContractInflight::Access::DECLARED_WRITE :
+               ContractInflight::Access::WRITE;
+}
+
+BlockExecutive::ContractInflight::Access BlockExecutive::nextAccess(
+    const ExecutiveState& executiveState)
+{
+    if (nextKeyLockMode(executiveState) == GraphKeyLocks::KeyLockMode::SHARED)
+    {
+        return ContractInflight::Access::READ;
+    }
+
+    auto& callStack = executiveState.callStack;
+    bool declared = false;
+    switch (executiveState.message->type())
+    {
+    case protocol::ExecutionMessage::MESSAGE:
+    case protocol::ExecutionMessage::TXHASH:
+        declared = opensDeclaredFrame(executiveState);
+        break;
+    case protocol::ExecutionMessage::FINISHED:
+    case protocol::ExecutionMessage::REVERT:
+        declared = callStack.size() > 1 && callStack[callStack.size() - 2].declared;
+        break;
+    default:
+        declared = !callStack.empty() && callStack.back().declared;
+        break;
+    }
+    return declared ? ContractInflight::Access::DECLARED_WRITE : ContractInflight::Access::WRITE;
+}
+
+void BlockExecutive::declareKeyLocks(ExecutiveState& executiveState)
+{
+    auto& message = *executiveState.message;
+    if (executiveState.declarationAsked || m_staticCall ||
+        message.type() != protocol::ExecutionMessage::TXHASH ||
+        !executiveState.callStack.empty() || message.to().empty())
+    {
+        return;
+    }
+    executiveState.declarationAsked = true;
+
+    auto executor = m_scheduler->m_executorManager->dispatchExecutor(message.to());
+    if (auto* declaring = dynamic_cast<KeyLockDeclaringExecutorInterface*>(executor.get()))
+    {
+        executiveState.declaredKeyLocks = declaring->declareKeyLocks(message);
+    }
+}
+
+BlockExecutive::MessageHint BlockExecutive::prepareMessage(ExecutiveState& executiveState)
+{
+    auto& message = executiveState.message;
+    auto contextID = executiveState.contextID;
+    auto seq = message->seq();
+
+    switch (message->type())
+    {
+    // Request type, push stack
+    case protocol::ExecutionMessage::MESSAGE:
+    case protocol::ExecutionMessage::TXHASH:
+    {
+        // Declared keys are locked all at once or the transaction waits, holding none of them
+        auto declared = opensDeclaredFrame(executiveState);
+        if (declared && !m_keyLocks.tryBatchAcquireKeyLock(message->to(),
+                            *executiveState.declaredKeyLocks, contextID, executiveState.currentSeq))
+        {
+            SCHEDULER_LOG(TRACE) << "Waiting declared keys, " << contextID << " | "
+                                 << message->to();
+            ++m_conflicts;
+            return MessageHint::WAIT;
+        }
+
+        auto newSeq = executiveState.currentSeq++;
+        if (message->to().empty())
+        {
+            if (message->createSalt())
+            {
+                message->setTo(
+                    newEVMAddress(message->from(), message->data(), *(message->createSalt())));
             }
             else
             {
-                // Process key locks & update order
-                traverseExecutive([this](ExecutiveState& executiveState) {
-                    if (executiveState.skip)
-                    {
-                        executiveState.skip = false;
-                        return SKIP;
-                    }
+                message->setTo(newEVMAddress(number(), contextID, newSeq));
+            }
+        }
+        executiveState.callStack.push_back({newSeq, opensStaticFrame(executiveState), declared});
+        executiveState.message->setSeq(newSeq);
+
+        SCHEDULER_LOG(TRACE) << "Execute, " << message->contextID() << " | " << message->seq()
+                             << " | " << std::hex << message->transactionHash() << " | "
+                             << message->to();
+
+        break;
+    }
+    // Return type, pop stack
+    case protocol::ExecutionMessage::FINISHED:
+    case protocol::ExecutionMessage::REVERT:
+    {
+        executiveState.callStack.pop_back();
 
+        // Empty stack, execution is finished
+        if (executiveState.callStack.empty())
+        {
+            finishExecutive(executiveState, *message);
+
+            // Remove executive state and continue
+            SCHEDULER_LOG(TRACE) << "Eraseing, " << message->contextID() << " | "
+                                 << message->seq() << " | " << std::hex
+                                 << message->transactionHash() << " | " << message->to();
+
+            return MessageHint::FINISH;
+        }
+
+        message->setSeq(executiveState.callStack.back().seq);
+        message->setCreate(false);
+
+        SCHEDULER_LOG(TRACE) << "FINISHED/REVERT, " << message->contextID() << " | "
+                             << message->seq() << " | " << std::hex << message->transactionHash()
+                             << " | " << message->to();
+
+        break;
+    }
+    case protocol::ExecutionMessage::REVERT_KEY_LOCK:
+    {
+        message->setType(protocol::ExecutionMessage::REVERT);
+        message->setCreate(false);
+        message->setKeyLocks({});
+        SCHEDULER_LOG(TRACE) << "REVERT By key lock, " << message->contextID() << " | "
+                             << message->seq() << " | " << std::hex << message->transactionHash()
+                             << " | " << message->to();
+
+        break;
+    }
+    // Retry type, send again
+    case protocol::ExecutionMessage::KEY_LOCK:
+    {
+        // Try acquire key lock
+        if (!m_keyLocks.acquireKeyLock(message->from(), message->keyLockAcquired(), contextID, seq,
+                keyLockMode(executiveState)))
+        {
+            SCHEDULER_LOG(TRACE) << "Waiting key, contract: " << contextID << " | " << seq
+                                 << " | " << message->from()
+                                 << " keyLockAcquired: " << toHex(message->keyLockAcquired());
+            ++m_conflicts;
+            return MessageHint::WAIT;
+        }
+
+        SCHEDULER_LOG(TRACE) << "Wait key lock success, " << contextID << " | " << seq << " | "
+                             << message->from()
+                             << " keyLockAcquired: " << toHex(message->keyLockAcquired());
+        break;
+    }
+    // Retry type, send again
+    case protocol::ExecutionMessage::SEND_BACK:
+    {
+        SCHEDULER_LOG(TRACE) << "Send back, " << contextID << " | " << seq << " | "
+                             << message->transactionHash();
+
+        if (message->transactionHash() != h256(0))
+        {
+            message->setType(protocol::ExecutionMessage::TXHASH);
+        }
+        else
+        {
+            message->setType(protocol::ExecutionMessage::MESSAGE);
+        }
+
+        if (message->to().empty())
+        {
+            if (message->createSalt())
+            {
+                message->setTo(
+                    newEVMAddress(message->from(), message->data(), *(message->createSalt())));
+            }
+            else
+            {
+                message->setTo(newEVMAddress(number(), contextID, seq));
+            }
+        }
+
+        break;
+    }
+    }
+
+    return MessageHint::SEND;
+}
+
+void BlockExecutive::finishExecutive(
+    ExecutiveState& executiveState, protocol::ExecutionMessage& message)
+{
+    m_executiveResults[executiveState.contextID].receipt =
+        m_scheduler->m_blockFactory->receiptFactory()->createReceipt(message.gasAvailable(),
+            message.newEVMContractAddress(),
+            std::make_shared<std::vector<bcos::protocol::LogEntry>>(message.takeLogEntries()),
+            message.status(), message.takeData(), m_block->blockHeaderConst()->number());
+
+    // Calc the gas
+    m_gasUsed += (TRANSACTION_GAS - message.gasAvailable());
+}
+
+void BlockExecutive::sendMessages(const std::vector<ExecutiveState*>& executiveStates,
+    const std::function<void(
+        ExecutiveState&, Error::UniquePtr, protocol::ExecutionMessage::UniquePtr)>& onResponse)
+{
+    // Messages of the round grouped by executor, executors are few. Executors keeping key lock
+    // tables get the changes of the tables instead of lists in the messages
+    std::vector<std::tuple<bcos::executor::ParallelTransactionExecutorInterface::Ptr,
+        std::vector<ExecutiveState*>>>
+        executorMessages;
+    std::vector<bool> withDeltas(executiveStates.size());
+    for (size_t i = 0; i < executiveStates.size(); ++i)
+    {
+        auto* executiveStatePtr = executiveStates[i];
+        auto executor =
+            m_scheduler->m_executorManager->dispatchExecutor(executiveStatePtr->message->to());
+        withDeltas[i] = dynamic_cast<KeyLockDeltaExecutorInterface*>(executor.get()) != nullptr;
+
+        auto it = std::find_if(executorMessages.begin(), executorMessages.end(),
+            [&executor](auto& group) { return std::get<0>(group) == executor; });
+        if (it == executorMessages.end())
+        {
+            it = executorMessages.emplace(executorMessages.end(), std::move(executor),
+                std::vector<ExecutiveState*>());
+        }
+        std::get<1>(*it).push_back(executiveStatePtr);
+    }
+
+    // Set current key lock into messages, a static call may read keys shared by others. The lock
+    // table is not changing, query the contracts in parallel. Messages to one contract share its
+    // conflicting keys of each mode and are served by one task
+    std::vector<size_t> order(executiveStates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&executiveStates](size_t lhs, size_t rhs) {
+        return executiveStates[lhs]->message->to() < executiveStates[rhs]->message->to();
+    });
+    std::vector<size_t> runs;  // Begin of each contract in order
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (i == 0 || executiveStates[order[i]]->message->to() !=
+                          executiveStates[order[i - 1]]->message->to())
+        {
+            runs.push_back(i);
+        }
+    }
+    runs.push_back(order.size());
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, runs.size() - 1),
+        [this, &executiveStates, &order, &runs, &withDeltas](
+            const tbb::blocked_range<size_t>& range) {
+            size_t bytes = 0;
+            for (auto run = range.begin(); run != range.end(); ++run)
+            {
+                std::array<std::shared_ptr<const GraphKeyLocks::ConflictingKeyLocks>, 2> keyLocks;
+                for (auto i = runs[run]; i < runs[run + 1]; ++i)
+                {
+                    auto& executiveState = *executiveStates[order[i]];
                     auto& message = executiveState.message;
-                    switch (message->type())
-                    {
-                    case protocol::ExecutionMessage::MESSAGE:
+                    if (withDeltas[order[i]])
                     {
-                        m_keyLocks.batchAcquireKeyLock(message->from(), message->keyLocks(),
-                            message->contextID(), message->seq());
-                        return UPDATE;
+                        message->setKeyLocks({});
+                        continue;
                     }
-                    case protocol::ExecutionMessage::KEY_LOCK:
+
+                    auto mode = keyLockMode(executiveState);
+                    auto& conflicting = keyLocks[static_cast<size_t>(mode)];
+                    if (!conflicting)
                     {
-                        m_keyLocks.batchAcquireKeyLock(message->from(), message->keyLocks(),
-                            message->contextID(), message->seq());
-                        return PASS;
+                        conflicting = m_keyLocks.getConflictingKeyLocks(message->to(), mode);
                     }
-                    case bcos::protocol::ExecutionMessage::FINISHED:
-                    case bcos::protocol::ExecutionMessage::REVERT:
+
+                    // Messages of the scheduler refer to the shared keys, others get a copy
+                    if (auto* keyLocksMessage = dynamic_cast<KeyLocksMessage*>(message.get()))
                     {
-                        m_keyLocks.releaseKeyLocks(message->contextID(), message->seq());
-                        return UPDATE;
+                        keyLocksMessage->setKeyLocks(conflicting, executiveState.contextID);
                     }
-                    case bcos::protocol::ExecutionMessage::REVERT_KEY_LOCK:
+                    else
                     {
-                        return PASS;
+                        message->setKeyLocks(
+                            conflicting->keysNotHoldingBy(executiveState.contextID));
                     }
-                    default:
+
+                    for (auto& key : message->keyLocks())
                     {
-                        return PASS;
+                        bytes += key.size();
                     }
+                }
+            }
+            m_keyLockListBytes += bytes;
+        });
+
+    if (c_fileLogLevel >= bcos::LogLevel::TRACE)
+    {
+        for (auto* executiveStatePtr : executiveStates)
+        {
+            auto& message = executiveStatePtr->message;
+            for (auto& keyIt : message->keyLocks())
+            {
+                SCHEDULER_LOG(TRACE)
+                    << boost::format(
+                           "Dispatch key lock type: %s, from: %s, to: %s, key: %s, "
+                           "contextID: %ld, seq: %ld") %
+                           message->type() % message->from() % message->to() % toHex(keyIt) %
+                           executiveStatePtr->contextID % message->seq();
+            }
+        }
+    }
+
+    for (auto& [executor, states] : executorMessages)
+    {
+        // Changes are taken while the lock table is not changing
+        auto deltas = keyLockDeltas(executor, states);
+
+        // Sent once the executor has switched to the block
+        auto* executorRaw = executor.get();
+        whenExecutorReady(executorRaw, [this, executor = std::move(executor),
+                                           states = std::move(states), deltas = std::move(deltas),
+                                           onResponse](const Error::Ptr& error) mutable {
+            if (error)
+            {
+                for (auto* executiveState : states)
+                {
+                    onResponse(*executiveState,
+                        BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                            SchedulerError::NextBlockError, "Next block error!", *error),
+                        nullptr);
+                }
+                return;
+            }
+
+            if (deltas.empty())
+            {
+                sendToExecutor(executor, std::move(states), onResponse);
+                return;
+            }
+
+            // The messages rely on the changes, send them once applied
+            auto deltaExecutor = std::dynamic_pointer_cast<KeyLockDeltaExecutorInterface>(executor);
+            deltaExecutor->updateKeyLocks(std::move(deltas),
+                [this, executor, states = std::move(states), onResponse](
+                    Error::UniquePtr error) mutable {
+                    if (error)
+                    {
+                        SCHEDULER_LOG(ERROR) << "Update key locks error: "
+                                             << boost::diagnostic_information(*error);
+                        for (auto* executiveState : states)
+                        {
+                            onResponse(*executiveState,
+                                BCOS_ERROR_WITH_PREV_UNIQUE_PTR(SchedulerError::KeyLockDeltaError,
+                                    "Update key locks error!", *error),
+                                nullptr);
+                        }
+                        return;
                     }
+
+                    sendToExecutor(executor, std::move(states), onResponse);
                 });
+        });
+    }
+}
+
+void BlockExecutive::sendToExecutor(
+    const bcos::executor::ParallelTransactionExecutorInterface::Ptr& executor,
+    std::vector<ExecutiveState*> executiveStates,
+    const std::function<void(
+        ExecutiveState&, Error::UniquePtr, protocol::ExecutionMessage::UniquePtr)>& onResponse)
+{
+    auto batchExecutor = std::dynamic_pointer_cast<BatchExecutorInterface>(executor);
+    if (batchExecutor && executiveStates.size() > 1)
+    {
+        sendBatch(*batchExecutor, std::move(executiveStates), onResponse);
+        return;
+    }
+
+    for (auto* executiveStatePtr : executiveStates)
+    {
+        auto& executiveState = *executiveStatePtr;
+        auto executeCallback = [&executiveState, onResponse](bcos::Error::UniquePtr error,
+                                   bcos::protocol::ExecutionMessage::UniquePtr response) {
+            onResponse(executiveState, std::move(error), std::move(response));
+        };
+
+        if (executiveState.message->staticCall())
+        {
+            executor->call(std::move(executiveState.message), std::move(executeCallback));
+        }
+        else
+        {
+            executor->executeTransaction(
+                std::move(executiveState.message), std::move(executeCallback));
+        }
+    }
+}
+
+std::vector<KeyLockDeltaExecutorInterface::KeyLockDelta> BlockExecutive::keyLockDeltas(
+    const bcos::executor::ParallelTransactionExecutorInterface::Ptr& executor,
+    const std::vector<ExecutiveState*>& executiveStates)
+{
+    std::vector<KeyLockDeltaExecutorInterface::KeyLockDelta> deltas;
+    if (!dynamic_cast<KeyLockDeltaExecutorInterface*>(executor.get()))
+    {
+        return deltas;
+    }
+
+    auto it = std::find_if(m_executorKeyLocks.begin(), m_executorKeyLocks.end(),
+        [&executor](auto& tables) { return std::get<0>(tables) == executor; });
+    if (it == m_executorKeyLocks.end())
+    {
+        it = m_executorKeyLocks.emplace(m_executorKeyLocks.end(), executor, ExecutorKeyLocks());
+    }
+    auto& tables = std::get<1>(*it);
+
+    size_t bytes = 0;
+    for (auto* executiveState : executiveStates)
+    {
+        auto& message = *executiveState->message;
+        auto mode = keyLockMode(*executiveState);
+        auto contractID = m_interner->internContract(message.to());
+        auto& sent = tables[static_cast<uint64_t>(contractID) * 2 + static_cast<uint64_t>(mode)];
+
+        auto current = m_keyLocks.getConflictingKeyLocks(message.to(), mode);
+        if ((sent ? sent->version : 0) == current->version)
+        {
+            continue;
+        }
+
+        auto& delta = deltas.emplace_back(KeyLockDeltaExecutorInterface::KeyLockDelta{
+            std::string(message.to()), mode, sent ? sent->version : 0, current->version, {}, {}});
+        if (sent)
+        {
+            // Both sorted by key
+            size_t i = 0;
+            size_t j = 0;
+            while (i < sent->keys.size() || j < current->keys.size())
+            {
+                if (j == current->keys.size() ||
+                    (i < sent->keys.size() && sent->keys[i] < current->keys[j]))
+                {
+                    delta.removes.push_back(sent->keys[i++]);
+                }
+                else if (i == sent->keys.size() || current->keys[j] < sent->keys[i])
+                {
+                    delta.updates.emplace_back(current->keys[j], current->holders[j]);
+                    ++j;
+                }
+                else
+                {
+                    if (sent->holders[i] != current->holders[j])
+                    {
+                        delta.updates.emplace_back(current->keys[j], current->holders[j]);
+                    }
+                    ++i;
+                    ++j;
+                }
             }
+        }
 
-            status.callback(nullptr);
+        // Fall back to the full list if it is smaller than the changes
+        if (!sent || delta.updates.size() + delta.removes.size() > current->keys.size())
+        {
+            delta.baseVersion = 0;
+            delta.updates.clear();
+            delta.removes.clear();
+            for (size_t i = 0; i < current->keys.size(); ++i)
+            {
+                delta.updates.emplace_back(current->keys[i], current->holders[i]);
+            }
+        }
+
+        for (auto& [key, holder] : delta.updates)
+        {
+            bytes += key.size() + sizeof(holder);
         }
+        for (auto& key : delta.removes)
+        {
+            bytes += key.size();
+        }
+        sent = std::move(current);
+    }
+    m_keyLockDeltaBytes += bytes;
+
+    return deltas;
+}
+
+void BlockExecutive::sendBatch(BatchExecutorInterface& executor,
+    std::vector<ExecutiveState*> executiveStates,
+    const std::function<void(
+        ExecutiveState&, Error::UniquePtr, protocol::ExecutionMessage::UniquePtr)>& onResponse)
+{
+    std::vector<protocol::ExecutionMessage::UniquePtr> messages;
+    messages.reserve(executiveStates.size());
+    for (auto* executiveState : executiveStates)
+    {
+        messages.push_back(std::move(executiveState->message));
     }
+
+    executor.executeTransactions(std::move(messages),
+        [executiveStates = std::move(executiveStates), onResponse](bcos::Error::UniquePtr error,
+            std::vector<bcos::protocol::ExecutionMessage::UniquePtr> responses) {
+            if (!error && responses.size() != executiveStates.size())
+            {
+                error = BCOS_ERROR_UNIQUE_PTR(SchedulerError::BatchError,
+                    "Batch responses: " + boost::lexical_cast<std::string>(responses.size()) +
+                        " mismatch messages: " +
+                        boost::lexical_cast<std::string>(executiveStates.size()));
+            }
+
+            // Fan the responses back, every message of a failed batch gets the error
+            for (size_t i = 0; i < executiveStates.size(); ++i)
+            {
+                if (error)
+                {
+                    onResponse(*executiveStates[i],
+                        BCOS_ERROR_WITH_PREV_UNIQUE_PTR(
+                            SchedulerError::BatchError, "Batch execute error", *error),
+                        nullptr);
+                }
+                else
+                {
+                    onResponse(*executiveStates[i], nullptr, std::move(responses[i]));
+                }
+            }
+        });
+}
+
+bool BlockExecutive::updateKeyLocks(
+    ExecutiveState& executiveState, std::vector<GraphKeyLocks::KeyLockRequest>& requests)
+{
+    auto& message = executiveState.message;
+    switch (message->type())
+    {
+    case protocol::ExecutionMessage::MESSAGE:
+    case protocol::ExecutionMessage::KEY_LOCK:
+    {
+        // The keys are held by the frame on top, a call is pushed once prepared
+        auto mode = keyLockMode(executiveState);
+        for (auto& key : message->keyLocks())
+        {
+            requests.push_back(GraphKeyLocks::KeyLockRequest{
+                message->from(), key, message->contextID(), message->seq(), mode});
+        }
+        return false;
+    }
+    case bcos::protocol::ExecutionMessage::FINISHED:
+    case bcos::protocol::ExecutionMessage::REVERT:
+    {
+        if (executiveState.callStack.size() == 1)
+        {
+            // The transaction is finished, drop the locks of all seqs
+            m_keyLocks.releaseAllKeyLocks(message->contextID());
+        }
+        else
+        {
+            m_keyLocks.releaseKeyLocks(message->contextID(), message->seq());
+        }
+        return true;
+    }
+    default:
+    {
+        return false;
+    }
+    }
+}
+
+bcos::Error::UniquePtr BlockExecutive::acquireBatchKeyLocks(
+    gsl::span<GraphKeyLocks::KeyLockRequest const> requests)
+{
+    auto grants = m_keyLocks.acquireKeyLocks(requests);
+    if (grants.denials.empty())
+    {
+        return nullptr;
+    }
+
+    // Executors only acquire keys not locked by others, a denial means the lock table is broken
+    for (auto& denial : grants.denials)
+    {
+        auto& request = requests[denial.request];
+        SCHEDULER_LOG(ERROR) << "Batch acquire lock failed" << LOG_KV("contract", request.contract)
+                             << LOG_KV("key", toHex(request.key))
+                             << LOG_KV("contextID", request.contextID)
+                             << LOG_KV("seq", request.seq) << LOG_KV("holder", denial.holder);
+    }
+
+    return BCOS_ERROR_UNIQUE_PTR(
+        SchedulerError::UnexpectedKeyLockError, "Batch acquire lock failed");
+}
+
+size_t BlockExecutive::revertDeadLockVictims()
+{
+    // Unfinished transactions not executing, only they can be in a dead lock
+    auto findExecutive = [this](ContextID contextID) -> ExecutiveState* {
+        if (contextID < 0 || static_cast<size_t>(contextID) >= m_executiveStates.size())
+        {
+            return nullptr;
+        }
+        auto& executiveState = m_executiveStates[contextID];
+        if (executiveState.callStack.empty() || !executiveState.message)
+        {
+            return nullptr;
+        }
+        return &executiveState;
+    };
+
+    // Dead locks are recorded when the wait-for edges are added, choose victims breaking all of
+    // them at once
+    auto policy = m_scheduler->m_deadLockVictimPolicy.load();
+    auto victims = m_keyLocks.selectDeadLockVictims(
+        policy, [&findExecutive](DeadLockVictimCandidate& candidate) {
+            if (auto* executiveState = findExecutive(candidate.contextID))
+            {
+                // Fill the executed work of candidate
+                candidate.callDepth = executiveState->callStack.size();
+                candidate.gasUsed = TRANSACTION_GAS - executiveState->message->gasAvailable();
+            }
+        });
+
+    size_t reverted = 0;
+    for (auto& victim : victims)
+    {
+        auto* executiveState = findExecutive(victim.contextID);
+        if (!executiveState)
+        {
+            continue;
+        }
+
+        SCHEDULER_LOG(INFO) << "Detected dead lock at " << victim.contextID << " | "
+                            << executiveState->message->seq() << " , revert"
+                            << LOG_KV("policy", static_cast<int>(policy))
+                            << LOG_KV("call depth", victim.callDepth)
+                            << LOG_KV("gas used", victim.gasUsed)
+                            << LOG_KV("holding locks", victim.holdingLocks);
+
+        m_scheduler->m_deadLockVictimStatistics[static_cast<size_t>(policy)].record(victim);
+        executiveState->message->setType(bcos::protocol::ExecutionMessage::REVERT_KEY_LOCK);
+        ++reverted;
+    }
+
+    return reverted;
 }
 
 std::string BlockExecutive::newEVMAddress(int64_t blockNumber, int64_t contextID, int64_t seq)
@@ -1119,55 +2439,42 @@ std::string BlockExecutive::preprocessAddress(const std::string_view& address)
     return out;
 }
 
-void BlockExecutive::traverseExecutive(std::function<TraverseHint(ExecutiveState&)> callback)
+void BlockExecutive::enqueueExecutive(ExecutiveState& executiveState)
 {
-    std::forward_list<decltype(m_executiveStates)::node_type> updateNodes;
+    auto& message = executiveState.message;
+    auto contractID = m_interner->internContract(message->to());
+    if (contractID >= m_contractQueues.size())
+    {
+        m_contractQueues.resize(contractID + 1);
+    }
 
-    for (auto it = m_executiveStates.begin(); it != m_executiveStates.end();)
+    SCHEDULER_LOG(TRACE) << "Enqueue context: " << executiveState.contextID << " | "
+                         << message->seq() << " | " << message->to();
+    m_contractQueues[contractID].ready.push(executiveState.contextID);
+    markRunnable(contractID);
+}
+
+void BlockExecutive::markRunnable(Interner::ContractID contractID)
+{
+    auto& queue = m_contractQueues[contractID];
+    if (!queue.runnable)
     {
-        SCHEDULER_LOG(TRACE) << "Traverse " << std::get<0>(it->first) << " | "
-                             << std::get<1>(it->first);
-        auto hint = callback(it->second);
-        switch (hint)
-        {
-        case PASS:
-        {
-            ++it;
-            break;
-        }
-        case DELETE:
-        {
-            m_executiveStates.erase(it++);
-            break;
-        }
-        case SKIP:
-        {
-            it = m_executiveStates.upper_bound({std::get<0>(it->first), INT64_MAX});
-            break;
-        }
-        case UPDATE:
-        {
-            updateNodes.emplace_front(m_executiveStates.extract(it++));
-            break;
-        }
-        case END:
-        {
-            goto OUT;
-        }
-        }
+        queue.runnable = true;
+        m_runnableContracts.push_back(contractID);
     }
+}
 
-OUT:
-    // Process the update nodes
-    if (!updateNodes.empty())
+void BlockExecutive::wakeWaitingExecutives()
+{
+    for (auto contractID : m_waitingContracts)
     {
-        for (auto it = updateNodes.begin(); it != updateNodes.end(); ++it)
+        auto& queue = m_contractQueues[contractID];
+        for (auto contextID : queue.waiting)
         {
-            it->key() = std::make_tuple(it->mapped().message->to(), it->mapped().contextID);
-
-            SCHEDULER_LOG(TRACE) << "Reinsert context: " << it->mapped().contextID << " | "
-                                 << it->mapped().message->seq() << " | " << std::get<0>(it->key());
-            m_executiveStates.insert(std::move(*it));
+            queue.ready.push(contextID);
         }
+        queue.waiting.clear();
+        markRunnable(contractID);
     }
-}
\ No newline at end of file
+    m_waitingContracts.clear();
+}
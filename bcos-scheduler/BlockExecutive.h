@@ -1,7 +1,13 @@
 #pragma once
 
+#include "BatchExecutorInterface.h"
+#include "BlockArena.h"
 #include "ExecutorManager.h"
 #include "GraphKeyLocks.h"
+#include "Interner.h"
+#include "KeyLockDeclaringExecutorInterface.h"
+#include "KeyLockDeltaExecutorInterface.h"
+#include "SpeculativeExecutorInterface.h"
 #include "bcos-framework/interfaces/executor/ExecutionMessage.h"
 #include "bcos-framework/interfaces/protocol/Block.h"
 #include "bcos-framework/interfaces/protocol/BlockHeader.h"
@@ -16,14 +22,18 @@
 #include "interfaces/protocol/TransactionReceiptFactory.h"
 #include <bcos-framework/interfaces/protocol/BlockFactory.h>
 #include <tbb/concurrent_unordered_map.h>
+#include <boost/container/small_vector.hpp>
 #include <boost/iterator/iterator_categories.hpp>
 #include <boost/range/any_range.hpp>
 #include <chrono>
 #include <forward_list>
+#include <limits>
 #include <mutex>
+#include <optional>
+#include <queue>
 #include <ratio>
-#include <stack>
 #include <thread>
+#include <unordered_map>
 
 namespace bcos::scheduler
 {
@@ -78,17 +88,17 @@ public:
     bool isCall() { return m_staticCall; }
 
 private:
+    // Memory of the block's bookkeeping, declared first to be freed after everything using it
+    BlockArena m_arena;
+
     void DAGExecute(std::function<void(Error::UniquePtr)> error);
     void DMTExecute(std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback);
-
-    enum TraverseHint : int8_t
-    {
-        PASS = 0,
-        DELETE,
-        SKIP,
-        UPDATE,
-        END,
-    };
+    // Build the messages of the block and index them, true if any transaction enables DAG
+    bool prepareExecutiveStates();
+    // Schedule mode of the block, the optimistic mode falls back to lock step where it can't apply
+    void chooseScheduleMode(bool withDAG);
+    void DMTFinish(std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback);
+    void DMTGetHashes(std::function<void(Error::UniquePtr, protocol::BlockHeader::Ptr)> callback);
 
     struct CommitStatus
     {
@@ -97,11 +107,50 @@ private:
         std::atomic_size_t failed = 0;
         std::function<void(const CommitStatus&)> checkAndCommit;
     };
-    void batchNextBlock(std::function<void(Error::UniquePtr)> callback);
+    // Send the block header to every executor without waiting, messages to an executor are held
+    // until its own header is acknowledged
+    void batchNextBlock();
+    void whenExecutorReady(bcos::executor::ParallelTransactionExecutorInterface* executor,
+        std::function<void(const Error::Ptr&)> send);
+    void whenAllExecutorsReady(std::function<void(const Error::Ptr&)> callback);
+
+    struct ExecutorReadiness
+    {
+        bool ready = false;
+        Error::Ptr error;  // The block header is rejected
+        std::vector<std::function<void(const Error::Ptr&)>> pending;
+    };
+    std::mutex m_executorReadinessMutex;
+    std::unordered_map<bcos::executor::ParallelTransactionExecutorInterface*, ExecutorReadiness>
+        m_executorReadiness;  // Executors the block header is sent to
     void batchGetHashes(std::function<void(Error::UniquePtr, crypto::HashType)> callback);
     void batchBlockCommit(std::function<void(Error::UniquePtr)> callback);
     void batchBlockRollback(std::function<void(Error::UniquePtr)> callback);
 
+    struct ExecutiveState;
+
+    // Messages executing at a contract, all of one access. Read only ones share the contract up to
+    // the window, so do writers of declared keys as their other keys are asked for by KEY_LOCK. Any
+    // other writer executes alone, its keys are unknown until it returns. Readers and declared
+    // writers don't mix, a reader's keys are not reported until it returns either
+    struct ContractInflight
+    {
+        enum class Access : int8_t
+        {
+            READ = 0,
+            DECLARED_WRITE,
+            WRITE,
+        };
+
+        uint32_t count = 0;
+        Access access = Access::READ;
+
+        bool admits(Access next, size_t window) const
+        {
+            return count == 0 || (next == access && next != Access::WRITE && count < window);
+        }
+    };
+
     struct BatchStatus  // Batch state per batch
     {
         std::atomic_size_t total = 0;
@@ -111,16 +160,146 @@ private:
         std::function<void(Error::UniquePtr)> callback;
         std::atomic_bool callbackExecuted = false;
         std::atomic_bool allSended = false;
+
+        std::vector<ExecutiveState*> states;  // Dispatched in this batch
     };
     void startBatch(std::function<void(Error::UniquePtr)> callback);
     void checkBatch(BatchStatus& status);
 
+    // Responses of the event driven DMT, only the draining thread changes the executive states
+    struct EventStatus
+    {
+        struct Response
+        {
+            ExecutiveState* executiveState;
+            Error::UniquePtr error;
+            protocol::ExecutionMessage::UniquePtr message;
+        };
+
+        std::mutex mutex;
+        std::vector<Response> responses;  // Arrived, not processed yet
+        bool draining = false;
+
+        size_t executing = 0;
+        size_t error = 0;
+        std::vector<ContractInflight> inflights;  // Indexed by contract id
+
+        std::function<void(Error::UniquePtr)> callback;
+    };
+    void eventExecute(std::function<void(Error::UniquePtr)> callback);
+    void drainEvents(const std::shared_ptr<EventStatus>& status);
+    void sendEvents(
+        const std::shared_ptr<EventStatus>& status, std::vector<ExecutiveState*>& sends);
+
+    // Transactions one after another in context order, the messages of each are sent back to back
+    // without key locks
+    struct SerialStatus
+    {
+        std::mutex mutex;
+        size_t context = 0;    // Executing transaction
+        bool sending = false;  // In the send call, the loop goes on with the response
+        bool responded = false;
+        bool keyLockSent = false;  // The executing transaction asked for a key lock already
+
+        std::function<void(Error::UniquePtr)> callback;
+    };
+    void serialExecute(std::function<void(Error::UniquePtr)> callback);
+    void serialLoop(const std::shared_ptr<SerialStatus>& status);
+
+    // Optimistic execution, valid speculations are applied in context order
+    struct OptimisticStatus
+    {
+        struct Context
+        {
+            SpeculativeExecutorInterface::Speculation speculation;
+            size_t base = 0;  // Contexts applied when speculated
+        };
+
+        bcos::executor::ParallelTransactionExecutorInterface::Ptr executor;
+        SpeculativeExecutorInterface* speculativeExecutor = nullptr;
+        std::vector<Context> contexts;  // Indexed by context
+        size_t applied = 0;             // Contexts before are applied
+        std::unordered_map<std::string, size_t> lastWriters;  // Last applied context of a key
+
+        size_t rounds = 0;
+        size_t speculations = 0;
+
+        std::function<void(Error::UniquePtr)> callback;
+    };
+    // The executor of every contract if it speculates transactions
+    bcos::executor::ParallelTransactionExecutorInterface::Ptr speculativeExecutor();
+    void optimisticExecute(bcos::executor::ParallelTransactionExecutorInterface::Ptr executor,
+        std::function<void(Error::UniquePtr)> callback);
+    void onSpeculations(const std::shared_ptr<OptimisticStatus>& status,
+        std::vector<size_t> contexts, Error::UniquePtr error,
+        std::vector<SpeculativeExecutorInterface::Speculation> speculations);
+    // Apply the valid speculations from the first context not applied on and pick the contexts to
+    // speculate again
+    void validateSpeculations(
+        OptimisticStatus& status, std::vector<size_t>& applies, std::vector<size_t>& speculates);
+
+    enum class MessageHint : int8_t
+    {
+        SEND = 0,
+        WAIT,    // Waiting for a key lock
+        FINISH,  // The transaction is finished
+    };
+    MessageHint prepareMessage(ExecutiveState& executiveState);
+    // Receipt and gas of a finished transaction
+    void finishExecutive(ExecutiveState& executiveState, protocol::ExecutionMessage& message);
+
+    // Prepare the ready messages of every runnable contract admitted by its in-flight messages,
+    // until `limit` messages are in sends. Contracts left over stay runnable
+    void dispatchRunnable(std::vector<ContractInflight>& inflights,
+        std::vector<ExecutiveState*>& sends, size_t limit = std::numeric_limits<size_t>::max());
+    void dispatchContract(Interner::ContractID contractID,
+        std::vector<ContractInflight>& inflights, std::vector<ExecutiveState*>& sends,
+        size_t limit);
+    // Most messages a dispatch may add while `executing` are in flight
+    size_t dispatchLimit(size_t executing) const;
+    void sortRunnable(std::vector<Interner::ContractID>& contracts);
+    void sendMessages(const std::vector<ExecutiveState*>& executiveStates,
+        const std::function<void(ExecutiveState&, Error::UniquePtr,
+            protocol::ExecutionMessage::UniquePtr)>& onResponse);
+    void sendToExecutor(const bcos::executor::ParallelTransactionExecutorInterface::Ptr& executor,
+        std::vector<ExecutiveState*> executiveStates,
+        const std::function<void(ExecutiveState&, Error::UniquePtr,
+            protocol::ExecutionMessage::UniquePtr)>& onResponse);
+    // Changes of the key lock tables an executor needs for the messages, none if it takes lists
+    std::vector<KeyLockDeltaExecutorInterface::KeyLockDelta> keyLockDeltas(
+        const bcos::executor::ParallelTransactionExecutorInterface::Ptr& executor,
+        const std::vector<ExecutiveState*>& executiveStates);
+    // One call for the messages of a round to an executor, responses are fanned back in order
+    void sendBatch(BatchExecutorInterface& executor, std::vector<ExecutiveState*> executiveStates,
+        const std::function<void(ExecutiveState&, Error::UniquePtr,
+            protocol::ExecutionMessage::UniquePtr)>& onResponse);
+    // Release the key locks of a returned frame or collect the acquired ones, true if released
+    bool updateKeyLocks(
+        ExecutiveState& executiveState, std::vector<GraphKeyLocks::KeyLockRequest>& requests);
+    Error::UniquePtr acquireBatchKeyLocks(gsl::span<GraphKeyLocks::KeyLockRequest const> requests);
+    size_t revertDeadLockVictims();
+
     std::string newEVMAddress(int64_t blockNumber, ContextID contextID, Seq seq);
     std::string newEVMAddress(
         const std::string_view& _sender, bytesConstRef _init, u256 const& _salt);
 
     std::string preprocessAddress(const std::string_view& address);
 
+    // Key locks are held by frames, a static frame only reads and shares them. The frame on top
+    // holds the keys of the responses and executes the prepared message
+    static GraphKeyLocks::KeyLockMode keyLockMode(const ExecutiveState& executiveState);
+    // Mode of the frame the message executes in once prepared: a call opens a frame, static if
+    // called so or from a static frame, a return resumes the caller, others stay on top
+    static GraphKeyLocks::KeyLockMode nextKeyLockMode(const ExecutiveState& executiveState);
+    static bool opensStaticFrame(const ExecutiveState& executiveState);
+    // Only the outermost frame of a transaction with declared keys is declared
+    static bool opensDeclaredFrame(const ExecutiveState& executiveState);
+    static ContractInflight::Access access(const ExecutiveState& executiveState);
+    // Of the frame the message executes in once prepared, as nextKeyLockMode
+    static ContractInflight::Access nextAccess(const ExecutiveState& executiveState);
+    // Ask the executor of a transaction not sent yet for its keys
+    void declareKeyLocks(ExecutiveState& executiveState);
+
     struct ExecutiveState  // Executive state per tx
     {
         ExecutiveState(int64_t _contextID, bcos::protocol::ExecutionMessage::UniquePtr _message,
@@ -128,17 +307,45 @@ private:
           : contextID(_contextID), message(std::move(_message)), enableDAG(_enableDAG)
         {}
 
+        struct Frame
+        {
+            int64_t seq;
+            bool staticCall;
+            bool declared = false;  // Its declared keys are locked, it asks for the others
+        };
+
         int64_t contextID;
-        std::stack<int64_t, std::list<int64_t>> callStack;
+        // Nested frames from the outermost, shallow stacks are kept inline without allocation
+        boost::container::small_vector<Frame, 8> callStack;
         bcos::protocol::ExecutionMessage::UniquePtr message;
         bcos::Error::UniquePtr error;
         int64_t currentSeq = 0;
         bool enableDAG;
-        bool skip = false;
+        std::optional<Interner::ContractID> executingContract;  // Sent and not back
+        bool declarationAsked = false;
+        // Keys of the transaction at its contract locked before it is sent, if declared
+        std::optional<std::vector<std::string>> declaredKeyLocks;
     };
 
-    std::map<std::tuple<std::string, ContextID>, ExecutiveState, std::less<>> m_executiveStates;
-    void traverseExecutive(std::function<TraverseHint(ExecutiveState&)> callback);
+    // Contracts and keys of this block
+    Interner::Ptr m_interner = std::make_shared<Interner>(&m_arena);
+
+    // States of a contract, waiting ones are ready again after key locks are released
+    struct ContractQueue
+    {
+        std::priority_queue<ContextID, std::vector<ContextID>, std::greater<>> ready;
+        std::vector<ContextID> waiting;
+        bool runnable = false;  // In m_runnableContracts
+    };
+
+    std::pmr::vector<ExecutiveState> m_executiveStates{&m_arena};  // Indexed by context
+    size_t m_unfinishedStates = 0;
+    std::pmr::vector<ContractQueue> m_contractQueues{&m_arena};  // Indexed by contract id
+    std::vector<Interner::ContractID> m_runnableContracts;
+    std::vector<Interner::ContractID> m_waitingContracts;
+    void enqueueExecutive(ExecutiveState& executiveState);
+    void markRunnable(Interner::ContractID contractID);
+    void wakeWaitingExecutives();
 
     struct ExecutiveResult
     {
@@ -146,14 +353,32 @@ private:
         bcos::crypto::HashType transactionHash;
         std::string source;
     };
-    std::vector<ExecutiveResult> m_executiveResults;
+    std::pmr::vector<ExecutiveResult> m_executiveResults{&m_arena};
 
     size_t m_gasUsed = 0;
 
-    GraphKeyLocks m_keyLocks;
+    DMTScheduleMode m_scheduleMode = DMTScheduleMode::LOCK_STEP;
+    size_t m_conflicts = 0;  // Messages waiting for key locks or transactions speculated again
+
+    // Transaction input of the block's messages, copied into messages not referring to it. Copies
+    // taken by executors are counted by the scheduler's statistics
+    std::atomic_size_t m_inputReferencedBytes = 0;
+    std::atomic_size_t m_inputCopiedBytes = 0;
+
+    GraphKeyLocks m_keyLocks{m_interner, &m_arena};
+
+    // Key lock tables sent to each executor taking changes, by contract id * 2 + mode
+    using ExecutorKeyLocks =
+        std::unordered_map<uint64_t, std::shared_ptr<const GraphKeyLocks::ConflictingKeyLocks>>;
+    std::vector<
+        std::tuple<bcos::executor::ParallelTransactionExecutorInterface::Ptr, ExecutorKeyLocks>>
+        m_executorKeyLocks;
+    std::atomic_size_t m_keyLockListBytes = 0;
+    std::atomic_size_t m_keyLockDeltaBytes = 0;
 
     std::chrono::system_clock::time_point m_currentTimePoint;
 
+    std::chrono::milliseconds m_prepareElapsed;
     std::chrono::milliseconds m_executeElapsed;
     std::chrono::milliseconds m_hashElapsed;
     std::chrono::milliseconds m_commitElapsed;
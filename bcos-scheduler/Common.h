@@ -25,6 +25,31 @@ enum SchedulerError
     BatchError,
     DMTError,
     DAGError,
+    KeyLockDeltaError,
+    SpeculationError,
+};
+
+// How the DMT messages of a block are scheduled
+enum class DMTScheduleMode : int8_t
+{
+    LOCK_STEP = 0,  // One message per contract per batch, a batch waits for all of its responses
+    // A response dispatches the next ready message of its contracts at once. Key locks are taken
+    // in the order responses arrive, so conflicting transactions may end differently on each node
+    // and a block runs in lock step unless SchedulerImpl::setNondeterministicScheduleAllowed
+    EVENT_DRIVEN,
+    // Transactions are speculated in parallel and validated in context order, on an executor of
+    // every contract taking SpeculativeExecutorInterface. Serially otherwise, to the same results
+    OPTIMISTIC,
+    SERIAL,  // A transaction at a time without key lock bookkeeping
+    // Lock step, or serial or optimistic for a single contract block, see ExecutionModeSelector
+    ADAPTIVE,
+};
+
+// Order of the runnable contracts when the DMT dispatches their ready messages
+enum class DMTDispatchOrder : int8_t
+{
+    CONTRACT = 0,   // In the order contracts are first seen in the block
+    CRITICAL_PATH,  // Most pending messages first, then in contract order
 };
 
 inline const uint64_t TRANSACTION_GAS = 30000000000;
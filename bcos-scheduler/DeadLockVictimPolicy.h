@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+#include <gsl/span>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+namespace bcos::scheduler
+{
+// How to choose the context to revert in a dead lock
+enum class DeadLockVictimPolicy : int8_t
+{
+    LOWEST_PROGRESS = 0,    // Smallest seq of the context's locks
+    YOUNGEST_CONTEXT,       // Largest contextID
+    SHALLOWEST_CALL_STACK,  // Fewest nested calls to revert
+    LEAST_GAS,              // Least gas consumed so far
+    FEWEST_LOCKS,           // Fewest holding key locks
+    COUNT,
+};
+
+struct DeadLockVictimCandidate
+{
+    ContextID contextID = 0;
+    Seq progress = 0;
+    size_t holdingLocks = 0;
+    size_t callDepth = 0;
+    int64_t gasUsed = 0;
+};
+
+// Work reverted by the victims chosen with a policy
+struct DeadLockVictimStatistics
+{
+    std::atomic_size_t victims = 0;
+    std::atomic_size_t revertedCallDepth = 0;
+    std::atomic_size_t revertedGas = 0;
+    std::atomic_size_t releasedLocks = 0;
+
+    void record(const DeadLockVictimCandidate& victim)
+    {
+        ++victims;
+        revertedCallDepth += victim.callDepth;
+        revertedGas += static_cast<size_t>(victim.gasUsed);
+        releasedLocks += victim.holdingLocks;
+    }
+};
+
+inline std::optional<DeadLockVictimCandidate> chooseDeadLockVictim(
+    DeadLockVictimPolicy policy, gsl::span<DeadLockVictimCandidate const> candidates)
+{
+    auto cost = [policy](const DeadLockVictimCandidate& candidate) -> int64_t {
+        switch (policy)
+        {
+        case DeadLockVictimPolicy::YOUNGEST_CONTEXT:
+            return -candidate.contextID;
+        case DeadLockVictimPolicy::SHALLOWEST_CALL_STACK:
+            return static_cast<int64_t>(candidate.callDepth);
+        case DeadLockVictimPolicy::LEAST_GAS:
+            return candidate.gasUsed;
+        case DeadLockVictimPolicy::FEWEST_LOCKS:
+            return static_cast<int64_t>(candidate.holdingLocks);
+        case DeadLockVictimPolicy::LOWEST_PROGRESS:
+        default:
+            return candidate.progress;
+        }
+    };
+
+    // Lowest cost, the youngest one if tie
+    std::optional<DeadLockVictimCandidate> victim;
+    for (auto& candidate : candidates)
+    {
+        if (!victim || cost(candidate) < cost(*victim) ||
+            (cost(candidate) == cost(*victim) && candidate.contextID > victim->contextID))
+        {
+            victim = candidate;
+        }
+    }
+
+    return victim;
+}
+
+}  // namespace bcos::scheduler
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Common.h"
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+namespace bcos::scheduler
+{
+// Chooses the schedule mode of a block under DMTScheduleMode::ADAPTIVE. Whether the block goes to
+// the DMT in lock step or executes in context order depends on cheap features of the block alone,
+// every node gives the block the same results. Only a single contract block executes in context
+// order, where the DMT does too. Such a block is speculated by the optimistic mode unless the
+// recent optimistic blocks were speculated again too often, then it executes serially for a few
+// blocks before speculating again. Both apply the transactions in context order, the conflict rate
+// differing between nodes picks the cheaper way only. The rate of speculations again per
+// transaction is a moving average weighting the latest optimistic block by 1 / WEIGHT
+class ExecutionModeSelector
+{
+public:
+    struct BlockFeatures
+    {
+        size_t transactions = 0;
+        size_t contracts = 0;        // Distinct contracts the transactions are sent to
+        size_t dagTransactions = 0;  // Transactions executed by DAG before the DMT
+        bool speculative = false;    // An executor of every contract speculates transactions
+    };
+
+    struct Choice
+    {
+        DMTScheduleMode mode;
+        const char* reason;
+    };
+
+    Choice choose(const BlockFeatures& features)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_lastChoice = chooseMode(features);
+        return *m_lastChoice;
+    }
+
+    // The choice for the block executed last
+    std::optional<Choice> lastChoice() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_lastChoice;
+    }
+
+    // Of an optimistic block
+    void record(size_t transactions, size_t respeculations)
+    {
+        if (transactions == 0)
+        {
+            return;
+        }
+
+        auto rate = static_cast<double>(respeculations) / transactions;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_conflictRate = m_conflictRate ? (*m_conflictRate * (WEIGHT - 1) + rate) / WEIGHT : rate;
+    }
+
+    // None before an optimistic block is executed
+    std::optional<double> conflictRate() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_conflictRate;
+    }
+
+    static constexpr double OPTIMISTIC_CONFLICT_RATE = 0.5;
+    static constexpr size_t SERIAL_BLOCKS = 8;  // Before speculating again
+
+private:
+    static constexpr double WEIGHT = 4;
+
+    Choice chooseMode(const BlockFeatures& features)
+    {
+        if (features.dagTransactions > 0)
+        {
+            return {DMTScheduleMode::LOCK_STEP, "DAG transactions, the rest in lock step"};
+        }
+        if (features.contracts > 1)
+        {
+            return {DMTScheduleMode::LOCK_STEP, "transactions spread over contracts"};
+        }
+        if (!features.speculative)
+        {
+            return {DMTScheduleMode::SERIAL, "single contract, executed serially"};
+        }
+        if (m_conflictRate && *m_conflictRate > OPTIMISTIC_CONFLICT_RATE &&
+            m_serialBlocks < SERIAL_BLOCKS)
+        {
+            ++m_serialBlocks;
+            return {DMTScheduleMode::SERIAL, "single contract, speculations conflict"};
+        }
+        m_serialBlocks = 0;
+        return {DMTScheduleMode::OPTIMISTIC, "single contract, speculated"};
+    }
+
+    mutable std::mutex m_mutex;
+    std::optional<double> m_conflictRate;
+    std::optional<Choice> m_lastChoice;
+    size_t m_serialBlocks = 0;  // Chosen for conflicting speculations in a row
+};
+}  // namespace bcos::scheduler
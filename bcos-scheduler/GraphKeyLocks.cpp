@@ -2,265 +2,1375 @@
 #include "Common.h"
 #include <bcos-framework/libutilities/DataConvertUtility.h>
 #include <bcos-framework/libutilities/Error.h>
-#include <boost/core/ignore_unused.hpp>
 #include <boost/format.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/detail/adjacency_list.hpp>
-#include <boost/graph/edge_list.hpp>
-#include <boost/graph/graph_selectors.hpp>
-#include <boost/graph/properties.hpp>
-#include <boost/graph/visitors.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <boost/throw_exception.hpp>
 #include <algorithm>
+#include <functional>
+#include <tuple>
+#include <unordered_set>
 
 using namespace bcos::scheduler;
 
-bool GraphKeyLocks::batchAcquireKeyLock(
-    std::string_view contract, gsl::span<std::string const> keys, ContextID contextID, Seq seq)
+bool GraphKeyLocks::batchAcquireKeyLock(std::string_view contract,
+    gsl::span<std::string const> keys, ContextID contextID, Seq seq, KeyLockMode mode)
 {
     if (!keys.empty())
     {
+        std::vector<KeyLockRequest> requests;
+        requests.reserve(keys.size());
         for (auto& it : keys)
         {
-            if (!acquireKeyLock(contract, it, contextID, seq))
+            requests.push_back(KeyLockRequest{contract, it, contextID, seq, mode});
+        }
+
+        auto grants = acquireKeyLocks(requests);
+        if (!grants.denials.empty())
+        {
+            auto& denial = grants.denials.front();
+            auto message = (boost::format("Batch acquire lock failed, contract: %s"
+                                          ", key: %s, contextID: %ld, seq: %ld, holder: %ld") %
+                            contract % toHex(keys[denial.request]) % contextID % seq %
+                            denial.holder)
+                               .str();
+            SCHEDULER_LOG(ERROR) << message;
+            BOOST_THROW_EXCEPTION(BCOS_ERROR(UnexpectedKeyLockError, message));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool GraphKeyLocks::acquireKeyLock(std::string_view contract, std::string_view key,
+    ContextID contextID, Seq seq, KeyLockMode mode)
+{
+    return !tryAcquireKeyLock(touchKeyLock(contract, key), contextID, seq, mode);
+}
+
+bool GraphKeyLocks::tryBatchAcquireKeyLock(std::string_view contract,
+    gsl::span<std::string const> keys, ContextID contextID, Seq seq, KeyLockMode mode)
+{
+    std::vector<KeyIndex> keyIndexes;
+    keyIndexes.reserve(keys.size());
+    for (auto& key : keys)
+    {
+        auto keyIndex = touchKeyLock(contract, key);
+        for (auto lockIndex = m_keys[keyIndex].holding; lockIndex != INVALID_INDEX;
+             lockIndex = m_locks[lockIndex].keyNext)
+        {
+            auto& lock = m_locks[lockIndex];
+            if (lock.contextID != contextID && conflicts(mode, lock.mode))
             {
-                auto message = (boost::format("Batch acquire lock failed, contract: %s"
-                                              ", key: %s, contextID: %ld, seq: %ld") %
-                                contract % toHex(it) % contextID % seq)
-                                   .str();
-                SCHEDULER_LOG(ERROR) << message;
-                BOOST_THROW_EXCEPTION(BCOS_ERROR(UnexpectedKeyLockError, message));
+                SCHEDULER_LOG(TRACE) << "Try batch acquire lock failed, contract: " << contract
+                                     << " key: " << toHex(key) << " contextID: " << contextID
+                                     << " holder: " << lock.contextID;
                 return false;
             }
         }
+        keyIndexes.push_back(keyIndex);
     }
 
+    for (auto keyIndex : keyIndexes)
+    {
+        tryAcquireKeyLock(keyIndex, contextID, seq, mode);
+    }
     return true;
 }
 
-bool GraphKeyLocks::acquireKeyLock(
-    std::string_view contract, std::string_view key, int64_t contextID, int64_t seq)
+GraphKeyLocks::KeyLockGrants GraphKeyLocks::acquireKeyLocks(
+    gsl::span<KeyLockRequest const> requests)
 {
-    auto keyVertex = touchKeyLock(std::make_tuple(contract, key));
-    auto contextVertex = touchContext(contextID);
+    KeyLockGrants grants;
+    grants.granted.resize(requests.size(), false);
+
+    // Intern all requests first, then visit each key's lists once
+    std::vector<std::tuple<KeyIndex, size_t>> keyRequests;
+    keyRequests.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        keyRequests.emplace_back(touchKeyLock(requests[i].contract, requests[i].key), i);
+    }
+    std::sort(keyRequests.begin(), keyRequests.end());
 
-    auto range = boost::out_edges(keyVertex, m_graph);
-    for (auto it = range.first; it != range.second; ++it)
+    std::vector<std::optional<ContextID>> holders(requests.size());
+    auto shards = requests.size() >= m_parallelAcquireSize ?
+                      partitionShards(requests, keyRequests) :
+                      std::vector<std::vector<std::tuple<KeyIndex, size_t>>>();
+    if (shards.size() > 1)
+    {
+        acquireKeyLocksByShard(requests, shards, holders);
+    }
+    else
     {
-        auto vertex = boost::get(VertexPropertyTag(), boost::target(*it, m_graph));
-        if (std::get<0>(*vertex) != contextID)
+        for (auto& [keyIndex, requestIndex] : keyRequests)
         {
-            SCHEDULER_LOG(TRACE) << boost::format(
-                                        "Acquire key lock failed, request: [%s, %s, %ld, %ld] "
-                                        "exists: [%ld]") %
-                                        contract % key % contextID % seq % std::get<0>(*vertex);
+            auto& request = requests[requestIndex];
+            holders[requestIndex] =
+                tryAcquireKeyLock(keyIndex, request.contextID, request.seq, request.mode);
+        }
+    }
 
-            // Key lock holding by another context
-            addEdge(contextVertex, keyVertex, seq);
-            return false;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (holders[i])
+        {
+            grants.denials.push_back(KeyLockGrants::Denial{i, *holders[i]});
+        }
+        else
+        {
+            grants.granted[i] = true;
         }
     }
 
-    // Remove all request edge
-    boost::remove_edge(contextVertex, keyVertex, m_graph);
+    return grants;
+}
+
+std::vector<std::vector<std::tuple<GraphKeyLocks::KeyIndex, size_t>>>
+GraphKeyLocks::partitionShards(gsl::span<KeyLockRequest const> requests,
+    const std::vector<std::tuple<KeyIndex, size_t>>& keyRequests)
+{
+    // Contracts are hashed to shards, shards sharing a requesting context are merged so every key,
+    // contract and requesting context is owned by exactly one group
+    std::vector<size_t> parents(SHARD_COUNT);
+    for (size_t i = 0; i < SHARD_COUNT; ++i)
+    {
+        parents[i] = i;
+    }
+    auto root = [&parents](size_t shard) {
+        while (parents[shard] != shard)
+        {
+            shard = parents[shard] = parents[parents[shard]];
+        }
+        return shard;
+    };
 
-    // Add an own edge
-    addEdge(keyVertex, contextVertex, seq);
+    std::vector<std::tuple<ContextID, size_t>> contextShards;
+    contextShards.reserve(keyRequests.size());
+    for (auto& [keyIndex, requestIndex] : keyRequests)
+    {
+        contextShards.emplace_back(
+            requests[requestIndex].contextID, m_interner->contractOf(keyIndex) % SHARD_COUNT);
+    }
+    std::sort(contextShards.begin(), contextShards.end());
+    for (size_t i = 1; i < contextShards.size(); ++i)
+    {
+        auto& [contextID, shard] = contextShards[i];
+        auto& [lastContextID, lastShard] = contextShards[i - 1];
+        if (contextID == lastContextID && shard != lastShard)
+        {
+            parents[root(shard)] = root(lastShard);
+        }
+    }
 
-    SCHEDULER_LOG(TRACE) << "Acquire key lock success, contract: " << contract << " key: " << key
-                         << " contextID: " << contextID << " seq: " << seq;
+    std::vector<std::vector<std::tuple<KeyIndex, size_t>>> shards;
+    std::vector<size_t> groups(SHARD_COUNT, INVALID_INDEX);
+    for (auto& keyRequest : keyRequests)
+    {
+        auto shard = root(m_interner->contractOf(std::get<0>(keyRequest)) % SHARD_COUNT);
+        if (groups[shard] == INVALID_INDEX)
+        {
+            groups[shard] = shards.size();
+            shards.emplace_back();
+        }
+        shards[groups[shard]].push_back(keyRequest);
+    }
 
-    return true;
+    return shards;
 }
 
+void GraphKeyLocks::acquireKeyLocksByShard(gsl::span<KeyLockRequest const> requests,
+    const std::vector<std::vector<std::tuple<KeyIndex, size_t>>>& shards,
+    std::vector<std::optional<ContextID>>& holders)
+{
+    // Shared structures are only changed here, before and after the parallel pass. Seqs and held
+    // keys a request may add are reserved too, the context pool and the memory resource are not
+    // synchronized
+    std::vector<ShardState> states(shards.size());
+    std::vector<ContextID> contextIDs;
+    std::vector<ContractIndex> contracts;
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        for (auto& [keyIndex, requestIndex] : shards[i])
+        {
+            contextIDs.push_back(requests[requestIndex].contextID);
+            contracts.push_back(m_interner->contractOf(keyIndex));
+
+            // A request adds one lock at most
+            LockIndex lockIndex;
+            if (m_freeLocks != INVALID_INDEX)
+            {
+                lockIndex = m_freeLocks;
+                m_freeLocks = m_locks[lockIndex].keyNext;
+            }
+            else
+            {
+                lockIndex = static_cast<LockIndex>(m_locks.size());
+                m_locks.emplace_back();
+            }
+            states[i].freeLocks.push_back(lockIndex);
+        }
+    }
+    std::sort(contextIDs.begin(), contextIDs.end());
+    for (auto it = contextIDs.begin(); it != contextIDs.end();)
+    {
+        auto next = std::upper_bound(it, contextIDs.end(), *it);
+        auto& seqs = touchContext(*it).seqs;
+        auto size = seqs.size() + static_cast<size_t>(next - it);
+        if (size > seqs.capacity())
+        {
+            seqs.reserve(std::max(size, seqs.capacity() * 2));
+        }
+        it = next;
+    }
+    std::sort(contracts.begin(), contracts.end());
+    for (auto it = contracts.begin(); it != contracts.end();)
+    {
+        auto next = std::upper_bound(it, contracts.end(), *it);
+        auto& heldKeys = m_contracts[*it].heldKeys;
+        auto size = heldKeys.size() + static_cast<size_t>(next - it);
+        if (size > heldKeys.capacity())
+        {
+            heldKeys.reserve(std::max(size, heldKeys.capacity() * 2));
+        }
+        it = next;
+    }
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, shards.size()),
+        [this, &requests, &shards, &states, &holders](const tbb::blocked_range<size_t>& range) {
+            for (auto i = range.begin(); i != range.end(); ++i)
+            {
+                for (auto& [keyIndex, requestIndex] : shards[i])
+                {
+                    auto& request = requests[requestIndex];
+                    holders[requestIndex] = tryAcquireKeyLock(
+                        keyIndex, request.contextID, request.seq, request.mode, &states[i]);
+                }
+            }
+        });
+
+    std::vector<LockIndex> addedLocks;
+    std::vector<std::tuple<ContextID, ContextID>> waitEdges;
+    for (auto& state : states)
+    {
+        for (auto lockIndex : state.freeLocks)
+        {
+            m_locks[lockIndex].keyNext = m_freeLocks;
+            m_freeLocks = lockIndex;
+        }
+        addedLocks.insert(addedLocks.end(), state.addedLocks.begin(), state.addedLocks.end());
+        waitEdges.insert(waitEdges.end(), state.waitEdges.begin(), state.waitEdges.end());
+    }
+
+    // Only edges the locks of this pass created are new, older ones were added with their locks
+    std::sort(addedLocks.begin(), addedLocks.end());
+    std::sort(waitEdges.begin(), waitEdges.end());
+    waitEdges.erase(std::unique(waitEdges.begin(), waitEdges.end()), waitEdges.end());
+    for (auto& [waiter, holder] : waitEdges)
+    {
+        if (!waitsFor(waiter, holder, addedLocks))
+        {
+            addWaitEdge(waiter, holder);
+        }
+    }
+}
 
 std::vector<std::string> GraphKeyLocks::getKeyLocksNotHoldingByContext(
-    std::string_view contract, int64_t excludeContextID) const
+    std::string_view contract, ContextID excludeContextID, KeyLockMode mode) const
 {
-    std::set<std::string> uniqueKeyLocks;
+    return getConflictingKeyLocks(contract, mode)->keysNotHoldingBy(excludeContextID);
+}
 
-    auto range = boost::edges(m_graph);
-    for (auto it = range.first; it != range.second; ++it)
+std::vector<std::string> GraphKeyLocks::ConflictingKeyLocks::keysNotHoldingBy(
+    ContextID contextID) const
+{
+    if (conflictsWithAll(contextID))
     {
-        auto sourceVertex = boost::get(VertexPropertyTag(), boost::source(*it, m_graph));
-        auto targetVertex = boost::get(VertexPropertyTag(), boost::target(*it, m_graph));
+        return keys;
+    }
 
-        if (targetVertex->index() == 0 && std::get<0>(*targetVertex) != excludeContextID &&
-            sourceVertex->index() == 1 && std::get<0>(std::get<1>(*sourceVertex)) == contract)
+    std::vector<std::string> keyLocks;
+    keyLocks.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (holders[i] != contextID)
         {
-            uniqueKeyLocks.emplace(std::get<1>(std::get<1>(*sourceVertex)));
+            keyLocks.push_back(keys[i]);
         }
     }
+    return keyLocks;
+}
 
-    std::vector<std::string> keyLocks;
-    keyLocks.reserve(uniqueKeyLocks.size());
-    for (auto& it : uniqueKeyLocks)
+std::shared_ptr<const GraphKeyLocks::ConflictingKeyLocks> GraphKeyLocks::getConflictingKeyLocks(
+    std::string_view contract, KeyLockMode mode) const
+{
+    static const auto emptyKeyLocks = std::make_shared<const ConflictingKeyLocks>();
+
+    auto snapshot = getKeyLocksSnapshot(contract);
+    if (snapshot->empty())
     {
-        keyLocks.emplace_back(std::move(it));
+        return emptyKeyLocks;
     }
 
-    return keyLocks;
+    auto& contractEntry = m_contracts[m_interner->findContract(contract)];
+    auto& conflicting = contractEntry.conflicting[static_cast<size_t>(mode)];
+    if (!conflicting)
+    {
+        auto keyLocks = std::make_shared<ConflictingKeyLocks>();
+        keyLocks->version = contractEntry.version;
+        for (auto it = snapshot->begin(); it != snapshot->end();)
+        {
+            // Entries of a key are adjacent
+            auto end = std::find_if(it, snapshot->end(),
+                [&it](const HeldKeyLock& held) { return held.key != it->key; });
+
+            std::optional<ContextID> holder;
+            size_t count = 0;
+            for (auto held = it; held != end; ++held)
+            {
+                if (conflicts(mode, held->mode))
+                {
+                    holder = held->contextID;
+                    ++count;
+                }
+            }
+            if (count > 0)
+            {
+                keyLocks->keys.push_back(it->key);
+                keyLocks->holders.push_back(
+                    count == 1 ? *holder : ConflictingKeyLocks::MANY_HOLDERS);
+                if (count == 1)
+                {
+                    keyLocks->soleHolders.push_back(*holder);
+                }
+            }
+            it = end;
+        }
+        std::sort(keyLocks->soleHolders.begin(), keyLocks->soleHolders.end());
+        keyLocks->soleHolders.erase(
+            std::unique(keyLocks->soleHolders.begin(), keyLocks->soleHolders.end()),
+            keyLocks->soleHolders.end());
+
+        conflicting = std::move(keyLocks);
+    }
+
+    return conflicting;
+}
+
+std::shared_ptr<const GraphKeyLocks::KeyLockSnapshot> GraphKeyLocks::getKeyLocksSnapshot(
+    std::string_view contract) const
+{
+    static const auto emptySnapshot = std::make_shared<const KeyLockSnapshot>();
+
+    auto contractIndex = m_interner->findContract(contract);
+    if (contractIndex >= m_contracts.size())
+    {
+        return emptySnapshot;
+    }
+
+    auto& contractEntry = m_contracts[contractIndex];
+    if (!contractEntry.snapshot)
+    {
+        // Lock set of the contract changed since last query, rebuild it
+        auto snapshot = std::make_shared<KeyLockSnapshot>();
+        snapshot->reserve(contractEntry.heldKeys.size());
+        for (auto keyIndex : contractEntry.heldKeys)
+        {
+            // One entry per holding context with its strongest mode
+            auto begin = snapshot->size();
+            for (auto lockIndex = m_keys[keyIndex].holding; lockIndex != INVALID_INDEX;
+                 lockIndex = m_locks[lockIndex].keyNext)
+            {
+                auto& lock = m_locks[lockIndex];
+                auto it = std::find_if(snapshot->begin() + begin, snapshot->end(),
+                    [&lock](const HeldKeyLock& held) { return held.contextID == lock.contextID; });
+                if (it == snapshot->end())
+                {
+                    snapshot->push_back(HeldKeyLock{
+                        std::string(m_interner->key(keyIndex)), lock.contextID, lock.mode});
+                }
+                else
+                {
+                    it->mode = std::max(it->mode, lock.mode);
+                }
+            }
+        }
+        std::sort(snapshot->begin(), snapshot->end(),
+            [](const HeldKeyLock& lhs, const HeldKeyLock& rhs) {
+                return std::tie(lhs.key, lhs.contextID) < std::tie(rhs.key, rhs.contextID);
+            });
+
+        contractEntry.snapshot = std::move(snapshot);
+    }
+
+    return contractEntry.snapshot;
 }
 
 void GraphKeyLocks::releaseKeyLocks(int64_t contextID, int64_t seq)
 {
     SCHEDULER_LOG(TRACE) << "Release key lock, contextID: " << contextID << " seq: " << seq;
-    auto vertex = touchContext(contextID);
 
-    auto edgeRemoveFunc = [seq, graph = &m_graph](auto range) mutable -> bool {
-        size_t total = 0;
-        size_t removed = 0;
+    auto it = m_contexts.find(contextID);
+    if (it == m_contexts.end())
+    {
+        return;
+    }
 
-        for (auto next = range.first; range.first != range.second; range.first = next)
+    auto seqIt = findSeq(it->second, seq);
+    if (seqIt != it->second.seqs.end())
+    {
+        // Locks of the seq are adjacent in the context's list
+        for (auto lockIndex = seqIt->first;
+             lockIndex != INVALID_INDEX && m_locks[lockIndex].seq == seq;)
         {
-            ++total;
-            ++next;
-            auto edgeSeq = boost::get(EdgePropertyTag(), *range.first);
-            if (edgeSeq == seq)
+            auto next = m_locks[lockIndex].contextNext;
+            if (bcos::LogLevel::TRACE >= bcos::c_fileLogLevel)
             {
-                ++removed;
-                if (bcos::LogLevel::TRACE >= bcos::c_fileLogLevel)
+                auto keyIndex = m_locks[lockIndex].key;
+                SCHEDULER_LOG(TRACE)
+                    << "Releasing key lock, contract: "
+                    << m_interner->contract(m_interner->contractOf(keyIndex))
+                    << " key: " << m_interner->key(keyIndex);
+            }
+            removeLock(lockIndex);
+            lockIndex = next;
+        }
+    }
+
+    if (it->second.locks == INVALID_INDEX)
+    {
+        // All locks had removed, delete the context
+        m_contexts.erase(it);
+    }
+
+    if (m_orderDirty)
+    {
+        removeBrokenDeadLocks();
+    }
+}
+
+void GraphKeyLocks::releaseAllKeyLocks(ContextID contextID)
+{
+    SCHEDULER_LOG(TRACE) << "Release all key locks, contextID: " << contextID;
+
+    auto it = m_contexts.find(contextID);
+    if (it == m_contexts.end())
+    {
+        return;
+    }
+
+    // The context is deleted, only unlink the locks from their keys
+    for (auto lockIndex = it->second.locks; lockIndex != INVALID_INDEX;)
+    {
+        auto next = m_locks[lockIndex].contextNext;
+        unlinkKeyLock(lockIndex);
+        m_locks[lockIndex].keyNext = m_freeLocks;
+        m_freeLocks = lockIndex;
+        lockIndex = next;
+    }
+    m_contexts.erase(it);
+
+    if (m_orderDirty)
+    {
+        removeBrokenDeadLocks();
+    }
+}
+
+bool GraphKeyLocks::detectDeadLock(ContextID contextID)
+{
+    removeBrokenDeadLocks();
+
+    for (auto& cycle : m_deadLocks)
+    {
+        if (std::find(cycle.begin(), cycle.end(), contextID) != cycle.end())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<DeadLockVictimCandidate> GraphKeyLocks::selectDeadLockVictims(
+    DeadLockVictimPolicy policy, const std::function<void(DeadLockVictimCandidate&)>& fill)
+{
+    std::vector<DeadLockVictimCandidate> victims;
+
+    removeBrokenDeadLocks();
+    if (m_deadLocks.empty())
+    {
+        return victims;
+    }
+
+    std::unordered_map<ContextID, DeadLockVictimCandidate> candidates;
+    auto candidateOf = [this, &candidates, &fill](ContextID contextID) {
+        auto [it, inserted] = candidates.try_emplace(contextID);
+        if (inserted)
+        {
+            it->second = makeCandidate(contextID);
+            if (fill)
+            {
+                fill(it->second);
+            }
+        }
+        return it->second;
+    };
+
+    std::vector<ContextID> contexts;
+    contexts.reserve(m_contexts.size());
+    for (auto& it : m_contexts)
+    {
+        contexts.push_back(it.first);
+    }
+
+    auto components = findCycleComponents(contexts, [](ContextID) { return true; });
+    while (!components.empty())
+    {
+        auto component = std::move(components.back());
+        components.pop_back();
+
+        // Prefer contexts whose revert breaks all cycles of the component
+        std::vector<DeadLockVictimCandidate> componentCandidates;
+        if (component.size() <= MAX_VICTIM_SEARCH_SIZE)
+        {
+            for (auto contextID : component)
+            {
+                auto remains = [&component, contextID](ContextID id) {
+                    return id != contextID &&
+                           std::find(component.begin(), component.end(), id) != component.end();
+                };
+                if (findCycleComponents(component, remains).empty())
                 {
-                    auto source =
-                        boost::get(VertexPropertyTag(), boost::source(*range.first, *graph));
-                    auto target =
-                        boost::get(VertexPropertyTag(), boost::target(*range.first, *graph));
-                    if (target->index() == 1)
-                    {
-                        source = target;
-                    }
-
-                    const auto& [contract, key] = std::get<1>(*source);
-                    SCHEDULER_LOG(TRACE)
-                        << "Releasing key lock, contract: " << contract << " key: " << key;
+                    componentCandidates.push_back(candidateOf(contextID));
                 }
-                boost::remove_edge(*range.first, *graph);
+            }
+        }
+        if (componentCandidates.empty())
+        {
+            for (auto contextID : component)
+            {
+                componentCandidates.push_back(candidateOf(contextID));
             }
         }
 
-        return total == removed;
-    };
+        auto victim = chooseDeadLockVictim(policy, componentCandidates);
+        victims.push_back(*victim);
+
+        SCHEDULER_LOG(TRACE) << "Select dead lock victim: " << victim->contextID
+                             << " component size: " << component.size();
 
-    auto clearedIn = edgeRemoveFunc(boost::in_edges(vertex, m_graph));
-    auto clearedOut = edgeRemoveFunc(boost::out_edges(vertex, m_graph));
+        // The rest of the component may still contain cycles
+        component.erase(std::find(component.begin(), component.end(), victim->contextID));
+        std::unordered_set<ContextID> members(component.begin(), component.end());
+        for (auto& it : findCycleComponents(
+                 component, [&members](ContextID contextID) { return members.count(contextID); }))
+        {
+            components.emplace_back(std::move(it));
+        }
+    }
+
+    return victims;
+}
+
+GraphKeyLocks::KeyIndex GraphKeyLocks::touchKeyLock(
+    std::string_view contract, std::string_view key)
+{
+    auto contractIndex = m_interner->internContract(contract);
+    auto keyIndex = m_interner->internKeyLock(contractIndex, key);
 
-    if (clearedIn && clearedOut)
+    if (m_contracts.size() <= contractIndex)
+    {
+        m_contracts.resize(m_interner->contractCount());
+    }
+    if (m_keys.size() <= keyIndex)
     {
-        // All edge had removed, delete the vertex
-        boost::remove_vertex(vertex, m_graph);
-        m_vertexes.erase(contextID);
+        m_keys.resize(m_interner->keyLockCount());
     }
+
+    return keyIndex;
 }
 
-bool GraphKeyLocks::detectDeadLock(ContextID contextID)
+std::optional<ContextID> GraphKeyLocks::tryAcquireKeyLock(
+    KeyIndex keyIndex, ContextID contextID, Seq seq, KeyLockMode mode, ShardState* shard)
 {
-    struct GraphVisitor
+    for (auto lockIndex = m_keys[keyIndex].holding; lockIndex != INVALID_INDEX;
+         lockIndex = m_locks[lockIndex].keyNext)
+    {
+        auto& lock = m_locks[lockIndex];
+        if (lock.contextID != contextID && conflicts(mode, lock.mode))
+        {
+            auto holder = lock.contextID;
+            SCHEDULER_LOG(TRACE) << boost::format(
+                                        "Acquire key lock failed, request: [%s, %s, %ld, %ld, %d] "
+                                        "exists: [%ld, %d]") %
+                                        m_interner->contract(m_interner->contractOf(keyIndex)) %
+                                        m_interner->key(keyIndex) % contextID % seq %
+                                        static_cast<int>(mode) % holder %
+                                        static_cast<int>(lock.mode);
+
+            // Key lock holding by another context in a conflicting mode
+            addLock(keyIndex, contextID, seq, mode, false, shard);
+            return holder;
+        }
+    }
+
+    // Remove all request locks
+    for (auto lockIndex = m_keys[keyIndex].waiting; lockIndex != INVALID_INDEX;)
     {
-        GraphVisitor(bool& backEdge) : m_backEdge(backEdge) {}
+        auto next = m_locks[lockIndex].keyNext;
+        if (m_locks[lockIndex].contextID == contextID)
+        {
+            removeLock(lockIndex, shard);
+        }
+        lockIndex = next;
+    }
+
+    // Add an own lock
+    addLock(keyIndex, contextID, seq, mode, true, shard);
 
-        void initialize_vertex(VertexID, const Graph&) {}
-        void start_vertex(VertexID, const Graph&) {}
-        void discover_vertex(VertexID, const Graph&) {}
-        void examine_edge(EdgeID, const Graph&) {}
-        void tree_edge(EdgeID, const Graph&) {}
-        void forward_or_cross_edge(EdgeID, const Graph&) {}
-        void finish_edge(EdgeID, const Graph&) {}
-        void finish_vertex(VertexID, const Graph&) {}
+    SCHEDULER_LOG(TRACE) << "Acquire key lock success, contract: "
+                         << m_interner->contract(m_interner->contractOf(keyIndex))
+                         << " key: " << m_interner->key(keyIndex) << " contextID: " << contextID
+                         << " seq: " << seq << " mode: " << static_cast<int>(mode);
+
+    return std::nullopt;
+}
 
-        void back_edge(EdgeID edgeID, const Graph&) const
+void GraphKeyLocks::addLock(KeyIndex keyIndex, ContextID contextID, Seq seq, KeyLockMode mode,
+    bool holding, ShardState* shard)
+{
+    auto& keyEntry = m_keys[keyIndex];
+    auto& head = holding ? keyEntry.holding : keyEntry.waiting;
+    for (auto lockIndex = head; lockIndex != INVALID_INDEX; lockIndex = m_locks[lockIndex].keyNext)
+    {
+        if (m_locks[lockIndex].contextID == contextID && m_locks[lockIndex].seq == seq)
         {
-            auto edgeSeq = boost::get(EdgePropertyTag(), edgeID);
-            SCHEDULER_LOG(TRACE) << "Detected back edge seq: " << edgeSeq;
+            if (m_locks[lockIndex].mode >= mode)
+            {
+                // Already exists
+                return;
+            }
 
-            m_backEdge = true;
+            // Upgrade, replace the shared lock
+            removeLock(lockIndex, shard);
+            break;
         }
+    }
 
-        bool& m_backEdge;
+    // Wait-for edges this lock creates, collected before linking it. A shard owns the key but not
+    // always the waiter, whose requests may be linked by another shard at once, so a shard keeps
+    // every edge and those older locks made already are dropped after the parallel pass
+    std::vector<std::tuple<ContextID, ContextID>> waitEdges;
+    auto addWaitEdgeOnce = [this, shard, &waitEdges](ContextID waiter, ContextID holder) {
+        if (shard)
+        {
+            shard->waitEdges.emplace_back(waiter, holder);
+        }
+        else if (std::find(waitEdges.begin(), waitEdges.end(), std::make_tuple(waiter, holder)) ==
+                     waitEdges.end() &&
+                 !waitsFor(waiter, holder))
+        {
+            waitEdges.emplace_back(waiter, holder);
+        }
     };
 
-    auto it = m_vertexes.find(bcos::scheduler::GraphKeyLocks::Vertex(contextID));
-    if (it == m_vertexes.end())
+    std::optional<KeyLockMode> heldMode;
+    if (!holding)
     {
-        // No vertex, may be removed
-        return false;
+        // Wait for every holder in a conflicting mode
+        for (auto lockIndex = keyEntry.holding; lockIndex != INVALID_INDEX;
+             lockIndex = m_locks[lockIndex].keyNext)
+        {
+            auto& lock = m_locks[lockIndex];
+            if (lock.contextID != contextID && conflicts(mode, lock.mode))
+            {
+                addWaitEdgeOnce(contextID, lock.contextID);
+            }
+        }
+    }
+    else
+    {
+        heldMode = holdingMode(keyIndex, contextID);
+        if (!heldMode || *heldMode < mode)
+        {
+            // The context becomes a holder of the key or a stronger one, waiters conflicting with
+            // the new mode wait for it
+            for (auto lockIndex = keyEntry.waiting; lockIndex != INVALID_INDEX;
+                 lockIndex = m_locks[lockIndex].keyNext)
+            {
+                auto& lock = m_locks[lockIndex];
+                if (lock.contextID != contextID && conflicts(lock.mode, mode))
+                {
+                    addWaitEdgeOnce(lock.contextID, contextID);
+                }
+            }
+        }
     }
 
-    if (boost::in_degree(it->second, m_graph) == 0)
+    auto& contextEntry = shard ? m_contexts.at(contextID) : touchContext(contextID);
+
+    LockIndex lockIndex;
+    if (shard)
     {
-        // No in degree, not holding key lock
-        return false;
+        lockIndex = shard->freeLocks.back();
+        shard->freeLocks.pop_back();
+        shard->addedLocks.push_back(lockIndex);
+    }
+    else if (m_freeLocks != INVALID_INDEX)
+    {
+        lockIndex = m_freeLocks;
+        m_freeLocks = m_locks[lockIndex].keyNext;
+    }
+    else
+    {
+        lockIndex = static_cast<LockIndex>(m_locks.size());
+        m_locks.emplace_back();
     }
 
-    std::map<VertexID, boost::default_color_type> vertexColors;
-    bool hasDeadLock = false;
-    boost::depth_first_visit(m_graph, it->second, GraphVisitor(hasDeadLock),
-        boost::make_assoc_property_map(vertexColors),
-        [&hasDeadLock](VertexID, const Graph&) { return hasDeadLock; });
+    m_locks[lockIndex] = Lock{keyIndex, contextID, seq, mode, holding, INVALID_INDEX, head,
+        INVALID_INDEX, INVALID_INDEX};
 
+    if (head != INVALID_INDEX)
+    {
+        m_locks[head].keyPrev = lockIndex;
+    }
+    head = lockIndex;
 
-    return hasDeadLock;
+    // Link before the first lock of the seq to keep the seq's locks adjacent
+    auto seqIt = findSeq(contextEntry, seq);
+    auto next = contextEntry.locks;
+    if (seqIt != contextEntry.seqs.end())
+    {
+        next = seqIt->first;
+        seqIt->first = lockIndex;
+    }
+    else
+    {
+        contextEntry.seqs.push_back(SeqLocks{seq, lockIndex});
+    }
+
+    auto prev = next != INVALID_INDEX ? m_locks[next].contextPrev : INVALID_INDEX;
+    m_locks[lockIndex].contextPrev = prev;
+    m_locks[lockIndex].contextNext = next;
+    if (prev != INVALID_INDEX)
+    {
+        m_locks[prev].contextNext = lockIndex;
+    }
+    else
+    {
+        contextEntry.locks = lockIndex;
+    }
+    if (next != INVALID_INDEX)
+    {
+        m_locks[next].contextPrev = lockIndex;
+    }
+
+    if (holding)
+    {
+        ++contextEntry.holdingCount;
+        updateHeldKeys(keyIndex, !heldMode || *heldMode < mode);
+    }
+
+    for (auto& [waiter, holder] : waitEdges)
+    {
+        addWaitEdge(waiter, holder);
+    }
 }
 
-GraphKeyLocks::VertexID GraphKeyLocks::touchContext(int64_t contextID)
+void GraphKeyLocks::removeLock(LockIndex lockIndex, ShardState* shard)
 {
-    auto [it, inserted] = m_vertexes.emplace(Vertex(contextID), VertexID());
+    unlinkKeyLock(lockIndex);
+
+    auto& lock = m_locks[lockIndex];
+    auto& contextEntry = m_contexts.at(lock.contextID);
+
+    auto seqIt = findSeq(contextEntry, lock.seq);
+    if (seqIt->first == lockIndex)
+    {
+        if (lock.contextNext != INVALID_INDEX && m_locks[lock.contextNext].seq == lock.seq)
+        {
+            seqIt->first = lock.contextNext;
+        }
+        else
+        {
+            // Last lock of the seq
+            contextEntry.seqs.erase(seqIt);
+        }
+    }
+
+    if (lock.contextPrev != INVALID_INDEX)
+    {
+        m_locks[lock.contextPrev].contextNext = lock.contextNext;
+    }
+    else
+    {
+        contextEntry.locks = lock.contextNext;
+    }
+    if (lock.contextNext != INVALID_INDEX)
+    {
+        m_locks[lock.contextNext].contextPrev = lock.contextPrev;
+    }
+
+    if (lock.holding)
+    {
+        --contextEntry.holdingCount;
+    }
+
+    if (shard)
+    {
+        shard->freeLocks.push_back(lockIndex);
+    }
+    else
+    {
+        lock.keyNext = m_freeLocks;
+        m_freeLocks = lockIndex;
+    }
+}
+
+void GraphKeyLocks::unlinkKeyLock(LockIndex lockIndex)
+{
+    auto& lock = m_locks[lockIndex];
+    auto& keyEntry = m_keys[lock.key];
+
+    if (lock.keyPrev != INVALID_INDEX)
+    {
+        m_locks[lock.keyPrev].keyNext = lock.keyNext;
+    }
+    else
+    {
+        (lock.holding ? keyEntry.holding : keyEntry.waiting) = lock.keyNext;
+    }
+    if (lock.keyNext != INVALID_INDEX)
+    {
+        m_locks[lock.keyNext].keyPrev = lock.keyPrev;
+    }
+
+    if (lock.holding)
+    {
+        auto heldMode = holdingMode(lock.key, lock.contextID);
+        updateHeldKeys(lock.key, !heldMode || *heldMode < lock.mode);
+    }
+}
+
+void GraphKeyLocks::updateHeldKeys(KeyIndex keyIndex, bool holdersChanged)
+{
+    auto& keyEntry = m_keys[keyIndex];
+    auto& contractEntry = m_contracts[m_interner->contractOf(keyIndex)];
+
+    auto held = keyEntry.holding != INVALID_INDEX;
+    if (held && keyEntry.heldPosition == INVALID_INDEX)
+    {
+        keyEntry.heldPosition = static_cast<uint32_t>(contractEntry.heldKeys.size());
+        contractEntry.heldKeys.push_back(keyIndex);
+    }
+    else if (!held && keyEntry.heldPosition != INVALID_INDEX)
+    {
+        auto last = contractEntry.heldKeys.back();
+        contractEntry.heldKeys[keyEntry.heldPosition] = last;
+        m_keys[last].heldPosition = keyEntry.heldPosition;
+        contractEntry.heldKeys.pop_back();
+        keyEntry.heldPosition = INVALID_INDEX;
+    }
+    else if (!holdersChanged)
+    {
+        // Holding contexts and their modes unchanged
+        return;
+    }
+
+    ++contractEntry.version;
+    contractEntry.snapshot.reset();
+    contractEntry.conflicting = {};
+}
+
+GraphKeyLocks::ContextEntry& GraphKeyLocks::touchContext(ContextID contextID)
+{
+    auto [it, inserted] = m_contexts.try_emplace(contextID);
     if (inserted)
     {
-        it->second = boost::add_vertex(&(it->first), m_graph);
+        // New contexts only wait for existing ones, order them first
+        it->second.order = m_nextOrder--;
     }
-    auto contextVertexID = it->second;
 
-    return contextVertexID;
+    return it->second;
 }
 
-GraphKeyLocks::VertexID GraphKeyLocks::touchKeyLock(KeyLockView keyLockView)
+std::pmr::vector<GraphKeyLocks::SeqLocks>::iterator GraphKeyLocks::findSeq(
+    ContextEntry& contextEntry, Seq seq)
 {
-    auto contractKeyView = keyLockView;
-    auto it = m_vertexes.lower_bound(contractKeyView);
-    if (it != m_vertexes.end() && it->first == contractKeyView)
+    // Nested calls lock and release at the deepest seqs, search from the back
+    auto it = std::find_if(contextEntry.seqs.rbegin(), contextEntry.seqs.rend(),
+        [seq](const SeqLocks& seqLocks) { return seqLocks.seq == seq; });
+    if (it == contextEntry.seqs.rend())
     {
-        return it->second;
+        return contextEntry.seqs.end();
+    }
+
+    return std::prev(it.base());
+}
+
+std::optional<GraphKeyLocks::KeyLockMode> GraphKeyLocks::holdingMode(
+    KeyIndex keyIndex, ContextID contextID) const
+{
+    std::optional<KeyLockMode> mode;
+    for (auto lockIndex = m_keys[keyIndex].holding; lockIndex != INVALID_INDEX;
+         lockIndex = m_locks[lockIndex].keyNext)
+    {
+        auto& lock = m_locks[lockIndex];
+        if (lock.contextID == contextID && (!mode || *mode < lock.mode))
+        {
+            mode = lock.mode;
+        }
+    }
+
+    return mode;
+}
+
+template <class Callback>
+bool GraphKeyLocks::forEachBlocker(const ContextEntry& contextEntry, Callback&& callback) const
+{
+    for (auto lockIndex = contextEntry.locks; lockIndex != INVALID_INDEX;
+         lockIndex = m_locks[lockIndex].contextNext)
+    {
+        auto& lock = m_locks[lockIndex];
+        if (lock.holding)
+        {
+            continue;
+        }
+
+        for (auto holdingIndex = m_keys[lock.key].holding; holdingIndex != INVALID_INDEX;
+             holdingIndex = m_locks[holdingIndex].keyNext)
+        {
+            auto& holding = m_locks[holdingIndex];
+            if (holding.contextID != lock.contextID && conflicts(lock.mode, holding.mode) &&
+                !callback(holding.contextID))
+            {
+                return false;
+            }
+        }
     }
 
-    auto inserted = m_vertexes.emplace_hint(it,
-        Vertex(std::make_tuple(
-            std::string(std::get<0>(contractKeyView)), std::string(std::get<1>(contractKeyView)))),
-        VertexID());
-    inserted->second = boost::add_vertex(&(inserted->first), m_graph);
-    return inserted->second;
+    return true;
+}
+
+std::vector<ContextID> GraphKeyLocks::blockersOf(ContextID contextID) const
+{
+    std::vector<ContextID> blockers;
+    forEachBlocker(m_contexts.at(contextID), [&blockers](ContextID blocker) {
+        blockers.push_back(blocker);
+        return true;
+    });
+    std::sort(blockers.begin(), blockers.end());
+    blockers.erase(std::unique(blockers.begin(), blockers.end()), blockers.end());
+
+    return blockers;
 }
 
-void GraphKeyLocks::addEdge(VertexID source, VertexID target, int64_t seq)
+bool GraphKeyLocks::waitsFor(
+    ContextID waiter, ContextID holder, const std::vector<LockIndex>& ignoredLocks) const
 {
-    bool exists = false;
+    auto it = m_contexts.find(waiter);
+    if (it == m_contexts.end())
+    {
+        return false;
+    }
 
-    auto range = boost::edge_range(source, target, m_graph);
-    for (auto it = range.first; it != range.second; ++it)
+    auto ignored = [&ignoredLocks](LockIndex lockIndex) {
+        return std::binary_search(ignoredLocks.begin(), ignoredLocks.end(), lockIndex);
+    };
+    for (auto lockIndex = it->second.locks; lockIndex != INVALID_INDEX;
+         lockIndex = m_locks[lockIndex].contextNext)
     {
-        auto edgeSeq = boost::get(EdgePropertyTag(), *it);
-        if (edgeSeq == seq)
+        auto& lock = m_locks[lockIndex];
+        if (lock.holding || ignored(lockIndex))
         {
-            exists = true;
+            continue;
+        }
+
+        for (auto holdingIndex = m_keys[lock.key].holding; holdingIndex != INVALID_INDEX;
+             holdingIndex = m_locks[holdingIndex].keyNext)
+        {
+            auto& holding = m_locks[holdingIndex];
+            if (holding.contextID == holder && conflicts(lock.mode, holding.mode) &&
+                !ignored(holdingIndex))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void GraphKeyLocks::addWaitEdge(ContextID waiter, ContextID holder)
+{
+    if (m_orderDirty)
+    {
+        checkDeadLock(waiter, holder);
+        return;
+    }
+
+    auto lowerBound = m_contexts[holder].order;
+    auto upperBound = m_contexts[waiter].order;
+    if (upperBound < lowerBound)
+    {
+        // Agree with the order
+        return;
+    }
+
+    // Contexts reachable from holder ordered before waiter
+    std::unordered_map<ContextID, ContextID> parents{{holder, holder}};
+    std::vector<ContextID> forward;
+    std::vector<ContextID> stack{holder};
+    while (!stack.empty())
+    {
+        auto current = stack.back();
+        stack.pop_back();
+        forward.push_back(current);
+
+        auto acyclic = forEachBlocker(m_contexts[current], [&](ContextID next) {
+            if (next == waiter)
+            {
+                recordDeadLock(waiter, holder, current, parents);
+                return false;
+            }
+
+            if (m_contexts[next].order < upperBound && parents.emplace(next, current).second)
+            {
+                stack.push_back(next);
+            }
+            return true;
+        });
+        if (!acyclic)
+        {
+            m_orderDirty = true;
+            return;
+        }
+    }
+
+    // Contexts reaching waiter ordered after holder
+    std::unordered_map<ContextID, ContextID> visited{{waiter, waiter}};
+    std::vector<ContextID> backward;
+    stack.push_back(waiter);
+    while (!stack.empty())
+    {
+        auto current = stack.back();
+        stack.pop_back();
+        backward.push_back(current);
+
+        for (auto lockIndex = m_contexts[current].locks; lockIndex != INVALID_INDEX;
+             lockIndex = m_locks[lockIndex].contextNext)
+        {
+            auto& lock = m_locks[lockIndex];
+            if (!lock.holding)
+            {
+                continue;
+            }
+
+            for (auto waitIndex = m_keys[lock.key].waiting; waitIndex != INVALID_INDEX;
+                 waitIndex = m_locks[waitIndex].keyNext)
+            {
+                auto& waiting = m_locks[waitIndex];
+                auto previous = waiting.contextID;
+                if (conflicts(waiting.mode, lock.mode) &&
+                    m_contexts[previous].order > lowerBound &&
+                    visited.emplace(previous, current).second)
+                {
+                    stack.push_back(previous);
+                }
+            }
         }
     }
 
-    if (!exists)
+    // Reuse the orders of both sets, backward ones first
+    auto byOrder = [this](ContextID lhs, ContextID rhs) {
+        return m_contexts[lhs].order < m_contexts[rhs].order;
+    };
+    std::sort(forward.begin(), forward.end(), byOrder);
+    std::sort(backward.begin(), backward.end(), byOrder);
+
+    std::vector<int64_t> orders;
+    orders.reserve(forward.size() + backward.size());
+    for (auto contextID : backward)
+    {
+        orders.push_back(m_contexts[contextID].order);
+    }
+    for (auto contextID : forward)
+    {
+        orders.push_back(m_contexts[contextID].order);
+    }
+    std::sort(orders.begin(), orders.end());
+
+    auto order = orders.begin();
+    for (auto contextID : backward)
+    {
+        m_contexts[contextID].order = *(order++);
+    }
+    for (auto contextID : forward)
+    {
+        m_contexts[contextID].order = *(order++);
+    }
+}
+
+void GraphKeyLocks::checkDeadLock(ContextID waiter, ContextID holder)
+{
+    // Only the new edge can close a cycle: search a path from holder back to waiter
+    std::unordered_map<ContextID, ContextID> parents{{holder, holder}};
+    std::vector<ContextID> stack{holder};
+    while (!stack.empty())
     {
-        boost::add_edge(source, target, seq, m_graph);
+        auto current = stack.back();
+        stack.pop_back();
+
+        auto it = m_contexts.find(current);
+        if (it == m_contexts.end())
+        {
+            continue;
+        }
+
+        auto acyclic = forEachBlocker(it->second, [&](ContextID next) {
+            if (next == waiter)
+            {
+                recordDeadLock(waiter, holder, current, parents);
+                return false;
+            }
+
+            if (parents.emplace(next, current).second)
+            {
+                stack.push_back(next);
+            }
+            return true;
+        });
+        if (!acyclic)
+        {
+            return;
+        }
     }
 }
 
-void GraphKeyLocks::removeEdge(VertexID source, VertexID target, int64_t seq)
+void GraphKeyLocks::recordDeadLock(ContextID waiter, ContextID holder, ContextID last,
+    const std::unordered_map<ContextID, ContextID>& parents)
 {
-    auto range = boost::edge_range(source, target, m_graph);
-    for (auto it = range.first; it != range.second; ++it)
+    std::vector<ContextID> cycle;
+    for (auto contextID = last;; contextID = parents.at(contextID))
     {
-        auto edgeSeq = boost::get(EdgePropertyTag(), *it);
-        if (edgeSeq == seq)
+        cycle.push_back(contextID);
+        if (contextID == holder)
         {
-            boost::remove_edge(*it, m_graph);
             break;
         }
     }
-}
\ No newline at end of file
+    cycle.push_back(waiter);
+    std::reverse(cycle.begin(), cycle.end());
+
+    SCHEDULER_LOG(TRACE) << "Detected dead lock, waiter: " << waiter << " holder: " << holder
+                         << " size: " << cycle.size();
+    m_deadLocks.emplace_back(std::move(cycle));
+}
+
+void GraphKeyLocks::removeBrokenDeadLocks()
+{
+    auto broken = [this](const std::vector<ContextID>& cycle) {
+        for (size_t i = 0; i < cycle.size(); ++i)
+        {
+            if (!waitsFor(cycle[i], cycle[(i + 1) % cycle.size()]))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto it = std::partition(m_deadLocks.begin(), m_deadLocks.end(),
+        [&broken](const std::vector<ContextID>& cycle) { return !broken(cycle); });
+    if (it == m_deadLocks.end())
+    {
+        return;
+    }
+
+    std::vector<std::vector<ContextID>> brokenDeadLocks(
+        std::make_move_iterator(it), std::make_move_iterator(m_deadLocks.end()));
+    m_deadLocks.erase(it, m_deadLocks.end());
+
+    // Another cycle may still pass through the remaining edges of a broken one
+    auto recorded = [this](ContextID waiter, ContextID holder) {
+        for (auto& cycle : m_deadLocks)
+        {
+            for (size_t i = 0; i < cycle.size(); ++i)
+            {
+                if (cycle[i] == waiter && cycle[(i + 1) % cycle.size()] == holder)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    for (auto& cycle : brokenDeadLocks)
+    {
+        for (size_t i = 0; i < cycle.size(); ++i)
+        {
+            auto waiter = cycle[i];
+            auto holder = cycle[(i + 1) % cycle.size()];
+            if (waitsFor(waiter, holder) && !recorded(waiter, holder))
+            {
+                checkDeadLock(waiter, holder);
+            }
+        }
+    }
+
+    if (m_deadLocks.empty())
+    {
+        // Acyclic again
+        rebuildOrder();
+        m_orderDirty = false;
+    }
+}
+
+void GraphKeyLocks::rebuildOrder()
+{
+    // Reverse post order of a depth first search is a topological order
+    std::unordered_map<ContextID, bool> visited;
+    std::vector<ContextID> postOrder;
+    std::vector<std::tuple<ContextID, std::vector<ContextID>, size_t>> stack;
+    for (auto& it : m_contexts)
+    {
+        if (!visited.emplace(it.first, true).second)
+        {
+            continue;
+        }
+
+        stack.emplace_back(it.first, blockersOf(it.first), 0);
+        while (!stack.empty())
+        {
+            auto& [current, blockers, position] = stack.back();
+            if (position == blockers.size())
+            {
+                postOrder.push_back(current);
+                stack.pop_back();
+                continue;
+            }
+
+            auto next = blockers[position++];
+            if (visited.emplace(next, true).second)
+            {
+                stack.emplace_back(next, blockersOf(next), 0);
+            }
+        }
+    }
+
+    int64_t order = 0;
+    for (auto it = postOrder.rbegin(); it != postOrder.rend(); ++it)
+    {
+        m_contexts[*it].order = order++;
+    }
+    m_nextOrder = -1;
+}
+
+DeadLockVictimCandidate GraphKeyLocks::makeCandidate(ContextID contextID) const
+{
+    DeadLockVictimCandidate candidate;
+    candidate.contextID = contextID;
+
+    auto it = m_contexts.find(contextID);
+    if (it == m_contexts.end())
+    {
+        return candidate;
+    }
+
+    candidate.holdingLocks = it->second.holdingCount;
+    for (auto& seqLocks : it->second.seqs)
+    {
+        candidate.progress = std::max(candidate.progress, seqLocks.seq);
+    }
+
+    return candidate;
+}
+
+std::vector<std::vector<ContextID>> GraphKeyLocks::findCycleComponents(
+    const std::vector<ContextID>& contexts, const std::function<bool(ContextID)>& exists) const
+{
+    // Tarjan's strongly connected components, only components with a cycle are returned
+    struct Visit
+    {
+        size_t index;
+        size_t lowLink;
+        bool onStack;
+    };
+    std::unordered_map<ContextID, Visit> visits;
+    std::vector<ContextID> componentStack;
+    std::vector<std::tuple<ContextID, std::vector<ContextID>, size_t>> stack;
+    std::vector<std::vector<ContextID>> components;
+
+    auto visit = [&](ContextID contextID) {
+        auto index = visits.size();
+        visits.emplace(contextID, Visit{index, index, true});
+        componentStack.push_back(contextID);
+        stack.emplace_back(contextID, blockersOf(contextID), 0);
+    };
+
+    for (auto root : contexts)
+    {
+        if (!exists(root) || visits.count(root))
+        {
+            continue;
+        }
+
+        visit(root);
+        while (!stack.empty())
+        {
+            auto current = std::get<0>(stack.back());
+            auto& blockers = std::get<1>(stack.back());
+            auto& position = std::get<2>(stack.back());
+            if (position != blockers.size())
+            {
+                auto next = blockers[position++];
+                if (!exists(next))
+                {
+                    continue;
+                }
+
+                auto it = visits.find(next);
+                if (it == visits.end())
+                {
+                    visit(next);
+                }
+                else if (it->second.onStack)
+                {
+                    auto& currentVisit = visits.at(current);
+                    currentVisit.lowLink = std::min(currentVisit.lowLink, it->second.index);
+                }
+                continue;
+            }
+
+            stack.pop_back();
+            auto& currentVisit = visits.at(current);
+            if (!stack.empty())
+            {
+                auto& parentVisit = visits.at(std::get<0>(stack.back()));
+                parentVisit.lowLink = std::min(parentVisit.lowLink, currentVisit.lowLink);
+            }
+
+            if (currentVisit.lowLink == currentVisit.index)
+            {
+                std::vector<ContextID> component;
+                ContextID member;
+                do
+                {
+                    member = componentStack.back();
+                    componentStack.pop_back();
+                    visits.at(member).onStack = false;
+                    component.push_back(member);
+                } while (member != current);
+
+                // No self wait, a single context never forms a cycle
+                if (component.size() > 1)
+                {
+                    components.emplace_back(std::move(component));
+                }
+            }
+        }
+    }
+
+    return components;
+}
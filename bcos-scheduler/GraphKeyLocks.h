@@ -1,22 +1,34 @@
 #pragma once
 
 #include "Common.h"
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/edge_list.hpp>
-#include <boost/graph/graph_selectors.hpp>
-#include <boost/graph/properties.hpp>
-#include <boost/graph/visitors.hpp>
-#include <any>
-#include <forward_list>
-#include <functional>
+#include "DeadLockVictimPolicy.h"
+#include "Interner.h"
 #include <gsl/span>
-#include <set>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
 #include <string_view>
-#include <variant>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace bcos::scheduler
 {
+// Key lock table of a block
+// Every (contract, key) is interned by the block's Interner and indexes the lock table, a key is
+// held exclusively by one context or shared by many, contexts failed to acquire it in a conflicting
+// mode are recorded in its waiting list. Every lock is also
+// linked into the list of its context grouped by seq, releasing a seq only touches its own locks.
+// Keys with a holder are indexed per contract, the per-contract query only touches that contract.
+// Dead locks are detected when a wait-for edge (waiter -> holder) is created. Contexts keep a
+// topological order of the wait-for graph (Pearce-Kelly), an edge agreeing with the order costs
+// O(1), otherwise only contexts between the two orders are searched and reordered. Detected
+// cycles are kept until one of their edges is gone. Lock tables are allocated from `resource`.
 class GraphKeyLocks
 {
 public:
@@ -27,98 +39,266 @@ public:
     using ContractView = std::string_view;
     using KeyView = std::string_view;
 
-    GraphKeyLocks() = default;
+    // Shared locks are taken by read only (static call) frames, they only conflict with exclusive
+    enum class KeyLockMode : int8_t
+    {
+        SHARED = 0,
+        EXCLUSIVE,
+    };
+
+    struct HeldKeyLock
+    {
+        std::string key;
+        ContextID contextID;
+        KeyLockMode mode;  // Strongest mode of the context on the key
+    };
+    // Held keys of a contract sorted by (key, contextID), one entry per holding context, shared
+    // until the contract's lock set changes
+    using KeyLockSnapshot = std::vector<HeldKeyLock>;
+
+    // Keys of a contract held in a mode conflicting with a request mode, shared by the messages to
+    // the contract until its lock set changes. Keys conflicting with one holder only are annotated
+    // with it, that holder does not conflict with them itself
+    struct ConflictingKeyLocks
+    {
+        static constexpr ContextID MANY_HOLDERS = std::numeric_limits<ContextID>::min();
+
+        std::vector<std::string> keys;  // Sorted
+        std::vector<ContextID> holders;  // Indexed as keys, the only conflicting holder or many
+        std::vector<ContextID> soleHolders;  // Sorted, contexts being the only holder of a key
+        uint64_t version = 0;  // Of the contract's lock set, 0 if no key is held
+
+        // Whether every key conflicts with the context, its list is `keys` as is
+        bool conflictsWithAll(ContextID contextID) const
+        {
+            return !std::binary_search(soleHolders.begin(), soleHolders.end(), contextID);
+        }
+        std::vector<std::string> keysNotHoldingBy(ContextID contextID) const;
+    };
+
+    struct KeyLockRequest
+    {
+        std::string_view contract;
+        std::string_view key;
+        ContextID contextID;
+        Seq seq;
+        KeyLockMode mode = KeyLockMode::EXCLUSIVE;
+    };
+
+    // Result of acquireKeyLocks, granted is indexed as the requests
+    struct KeyLockGrants
+    {
+        struct Denial
+        {
+            size_t request;
+            ContextID holder;  // A context holding the key in a conflicting mode
+        };
+
+        std::vector<bool> granted;
+        std::vector<Denial> denials;  // In request order
+    };
+
+    explicit GraphKeyLocks(Interner::Ptr interner = std::make_shared<Interner>(),
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_interner(std::move(interner)),
+        m_contracts(resource),
+        m_keys(resource),
+        m_locks(resource),
+        m_contextPool(resource),
+        m_contexts(&m_contextPool)
+    {}
     GraphKeyLocks(const GraphKeyLocks&) = delete;
     GraphKeyLocks(GraphKeyLocks&&) = delete;
     GraphKeyLocks& operator=(const GraphKeyLocks&) = delete;
     GraphKeyLocks& operator=(GraphKeyLocks&&) = delete;
 
     bool batchAcquireKeyLock(std::string_view contract, gsl::span<std::string const> keyLocks,
-        ContextID contextID, Seq seq);
+        ContextID contextID, Seq seq, KeyLockMode mode = KeyLockMode::EXCLUSIVE);
+
+    bool acquireKeyLock(std::string_view contract, std::string_view key, ContextID contextID,
+        Seq seq, KeyLockMode mode = KeyLockMode::EXCLUSIVE);
 
-    bool acquireKeyLock(
-        std::string_view contract, std::string_view key, ContextID contextID, Seq seq);
+    // Acquire every key or none if one is held by another context in a conflicting mode, nothing
+    // waits for the holder
+    bool tryBatchAcquireKeyLock(std::string_view contract, gsl::span<std::string const> keyLocks,
+        ContextID contextID, Seq seq, KeyLockMode mode = KeyLockMode::EXCLUSIVE);
 
-    std::vector<std::string> getKeyLocksNotHoldingByContext(
-        std::string_view contract, ContextID excludeContextID) const;
+    // Acquire the key locks of a whole batch in one pass, requests are grouped by key and the
+    // requests of one key are served in their order. Denied requests wait for the holder as
+    // acquireKeyLock does. Large batches are served in parallel by contract shards
+    KeyLockGrants acquireKeyLocks(gsl::span<KeyLockRequest const> requests);
+
+    // Batches from `size` requests are served in parallel by contract shards
+    void setParallelAcquireSize(size_t size) { m_parallelAcquireSize = size; }
+
+    // Keys held by other contexts in a mode conflicting with `mode`. Queries of different contracts
+    // may run concurrently while no lock is changing
+    std::vector<std::string> getKeyLocksNotHoldingByContext(std::string_view contract,
+        ContextID excludeContextID, KeyLockMode mode = KeyLockMode::EXCLUSIVE) const;
+
+    std::shared_ptr<const KeyLockSnapshot> getKeyLocksSnapshot(std::string_view contract) const;
+
+    // Cached with the snapshot, queries of different contracts may run concurrently as above
+    std::shared_ptr<const ConflictingKeyLocks> getConflictingKeyLocks(
+        std::string_view contract, KeyLockMode mode = KeyLockMode::EXCLUSIVE) const;
 
     void releaseKeyLocks(ContextID contextID, Seq seq);
 
+    // Release the locks of every seq at once when the transaction of the context is finished
+    void releaseAllKeyLocks(ContextID contextID);
+
     bool detectDeadLock(ContextID contextID);
 
-    struct Vertex : public std::variant<ContextID, KeyLock>
+    // Choose victims breaking every dead lock at once, one by one from each strongly connected
+    // component of the wait-for graph until no cycle left. A context breaking the whole component
+    // is preferred, `fill` completes the candidates before the policy ranks them
+    std::vector<DeadLockVictimCandidate> selectDeadLockVictims(DeadLockVictimPolicy policy,
+        const std::function<void(DeadLockVictimCandidate&)>& fill = {});
+
+private:
+    using ContractIndex = Interner::ContractID;
+    using KeyIndex = Interner::KeyLockID;
+    using LockIndex = uint32_t;
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t MAX_VICTIM_SEARCH_SIZE = 64;
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr size_t PARALLEL_ACQUIRE_SIZE = 4096;  // Requests worth a parallel pass
+
+    struct ContractEntry
     {
-        using std::variant<ContextID, KeyLock>::variant;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
 
-        bool operator==(const KeyLockView& rhs) const
-        {
-            if (index() != 1)
-            {
-                return false;
-            }
-
-            auto view = std::make_tuple(std::string_view(std::get<0>(std::get<1>(*this))),
-                std::string_view(std::get<1>(std::get<1>(*this))));
-            return view == rhs;
-        }
+        explicit ContractEntry(const allocator_type& allocator) : heldKeys(allocator) {}
+        ContractEntry(ContractEntry&& other, const allocator_type& allocator)
+          : heldKeys(std::move(other.heldKeys), allocator),
+            version(other.version),
+            snapshot(std::move(other.snapshot)),
+            conflicting(std::move(other.conflicting))
+        {}
+
+        std::pmr::vector<KeyIndex> heldKeys;  // Keys of the contract with a holding context
+        uint64_t version = 1;                 // Changed with the lock set
+        mutable std::shared_ptr<const KeyLockSnapshot> snapshot;
+        // Indexed by request mode
+        mutable std::array<std::shared_ptr<const ConflictingKeyLocks>, 2> conflicting;
     };
 
-private:
-    struct VertexIterator
+    struct KeyEntry
     {
-        using kind = boost::vertex_property_tag;
+        LockIndex holding = INVALID_INDEX;  // One context, or many with shared locks only
+        LockIndex waiting = INVALID_INDEX;
+        uint32_t heldPosition = INVALID_INDEX;  // Position in heldKeys of the contract
     };
-    using VertexProperty = boost::property<VertexIterator, const Vertex*>;
-    struct EdgeSeq
+
+    struct Lock
     {
-        using kind = boost::edge_property_tag;
-    };
-    using EdgeProperty = boost::property<EdgeSeq, int64_t>;
+        KeyIndex key;
+        ContextID contextID;
+        Seq seq;
+        KeyLockMode mode;
+        bool holding;
 
-    using Graph = boost::adjacency_list<boost::multisetS, boost::multisetS, boost::bidirectionalS,
-        VertexProperty, EdgeProperty>;
-    using VertexPropertyTag = boost::property_map<Graph, VertexIterator>::const_type;
-    using EdgePropertyTag = boost::property_map<Graph, EdgeSeq>::const_type;
-    using VertexID = Graph::vertex_descriptor;
-    using EdgeID = Graph::edge_descriptor;
+        // Links in the holding or waiting list of the key
+        LockIndex keyPrev;
+        LockIndex keyNext;
 
-    Graph m_graph;
-    std::map<Vertex, VertexID, std::less<>> m_vertexes;
+        // Links in the lock list of the context
+        LockIndex contextPrev;
+        LockIndex contextNext;
+    };
 
-    VertexID touchContext(ContextID contextID);
-    VertexID touchKeyLock(KeyLockView keylockView);
+    struct SeqLocks
+    {
+        Seq seq;
+        LockIndex first;  // First lock of the seq in the context's lock list
+    };
 
-    void addEdge(VertexID source, VertexID target, Seq seq);
-    void removeEdge(VertexID source, VertexID target, Seq seq);
-};
+    struct ContextEntry
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
 
-}  // namespace bcos::scheduler
+        explicit ContextEntry(const allocator_type& allocator) : seqs(allocator) {}
+        ContextEntry(ContextEntry&& other, const allocator_type& allocator)
+          : locks(other.locks),
+            seqs(std::move(other.seqs), allocator),
+            holdingCount(other.holdingCount),
+            order(other.order)
+        {}
 
-namespace std
-{
-inline bool operator<(const bcos::scheduler::GraphKeyLocks::Vertex& lhs,
-    const bcos::scheduler::GraphKeyLocks::KeyLockView& rhs)
-{
-    if (lhs.index() != 1)
+        LockIndex locks = INVALID_INDEX;  // Locks of one seq are adjacent
+        std::pmr::vector<SeqLocks> seqs;  // In first acquired order
+        size_t holdingCount = 0;
+        int64_t order = 0;  // Waiters are ordered before holders
+    };
+
+    // Lock slots, added locks and wait-for edges of a shard while acquiring in parallel
+    struct ShardState
     {
-        return true;
-    }
+        std::vector<LockIndex> freeLocks;
+        std::vector<LockIndex> addedLocks;
+        std::vector<std::tuple<ContextID, ContextID>> waitEdges;
+    };
 
-    auto view = std::make_tuple(std::string_view(std::get<0>(std::get<1>(lhs))),
-        std::string_view(std::get<1>(std::get<1>(lhs))));
-    return view < rhs;
-}
+    Interner::Ptr m_interner;
+    std::pmr::vector<ContractEntry> m_contracts;  // Indexed by contract id
+    std::pmr::vector<KeyEntry> m_keys;            // Indexed by key lock id
+    std::pmr::vector<Lock> m_locks;
+    LockIndex m_freeLocks = INVALID_INDEX;
+    // Contexts and their seqs come and go, their memory is reused from a pool over `resource`
+    std::pmr::unsynchronized_pool_resource m_contextPool;
+    std::pmr::unordered_map<ContextID, ContextEntry> m_contexts;
 
-inline bool operator<(const bcos::scheduler::GraphKeyLocks::KeyLockView& lhs,
-    const bcos::scheduler::GraphKeyLocks::Vertex& rhs)
-{
-    if (rhs.index() != 1)
+    // Every context in a cycle waits for the next one, the last waits for the first
+    std::vector<std::vector<ContextID>> m_deadLocks;
+    int64_t m_nextOrder = -1;
+    bool m_orderDirty = false;  // Cycles exist, search without order until they are broken
+    size_t m_parallelAcquireSize = PARALLEL_ACQUIRE_SIZE;
+
+    static bool conflicts(KeyLockMode lhs, KeyLockMode rhs)
     {
-        return false;
+        return lhs == KeyLockMode::EXCLUSIVE || rhs == KeyLockMode::EXCLUSIVE;
     }
 
-    auto view = std::make_tuple(std::string_view(std::get<0>(std::get<1>(rhs))),
-        std::string_view(std::get<1>(std::get<1>(rhs))));
-    return lhs < view;
-}
-}  // namespace std
\ No newline at end of file
+    KeyIndex touchKeyLock(std::string_view contract, std::string_view key);
+    std::optional<ContextID> tryAcquireKeyLock(KeyIndex keyIndex, ContextID contextID, Seq seq,
+        KeyLockMode mode, ShardState* shard = nullptr);
+
+    std::vector<std::vector<std::tuple<KeyIndex, size_t>>> partitionShards(
+        gsl::span<KeyLockRequest const> requests,
+        const std::vector<std::tuple<KeyIndex, size_t>>& keyRequests);
+    void acquireKeyLocksByShard(gsl::span<KeyLockRequest const> requests,
+        const std::vector<std::vector<std::tuple<KeyIndex, size_t>>>& shards,
+        std::vector<std::optional<ContextID>>& holders);
+
+    void addLock(KeyIndex keyIndex, ContextID contextID, Seq seq, KeyLockMode mode, bool holding,
+        ShardState* shard = nullptr);
+    void removeLock(LockIndex lockIndex, ShardState* shard = nullptr);
+    void unlinkKeyLock(LockIndex lockIndex);
+    void updateHeldKeys(KeyIndex keyIndex, bool holdersChanged);
+
+    ContextEntry& touchContext(ContextID contextID);
+    static std::pmr::vector<SeqLocks>::iterator findSeq(ContextEntry& contextEntry, Seq seq);
+    std::optional<KeyLockMode> holdingMode(KeyIndex keyIndex, ContextID contextID) const;
+
+    // Calls `callback` with every context holding a key the context waits for in a conflicting
+    // mode, may repeat a context. Stops and returns false once `callback` returns false
+    template <class Callback>
+    bool forEachBlocker(const ContextEntry& contextEntry, Callback&& callback) const;
+    std::vector<ContextID> blockersOf(ContextID contextID) const;
+    // Ignoring the sorted `ignoredLocks`
+    bool waitsFor(ContextID waiter, ContextID holder,
+        const std::vector<LockIndex>& ignoredLocks = std::vector<LockIndex>()) const;
+
+    void addWaitEdge(ContextID waiter, ContextID holder);
+    void checkDeadLock(ContextID waiter, ContextID holder);
+    void recordDeadLock(ContextID waiter, ContextID holder, ContextID last,
+        const std::unordered_map<ContextID, ContextID>& parents);
+    void removeBrokenDeadLocks();
+    void rebuildOrder();
+
+    DeadLockVictimCandidate makeCandidate(ContextID contextID) const;
+    std::vector<std::vector<ContextID>> findCycleComponents(
+        const std::vector<ContextID>& contexts, const std::function<bool(ContextID)>& exists) const;
+};
+
+}  // namespace bcos::scheduler
@@ -0,0 +1,112 @@
+#include "Interner.h"
+#include <algorithm>
+#include <functional>
+
+using namespace bcos::scheduler;
+
+Interner::ContractID Interner::internContract(std::string_view contract)
+{
+    auto it = m_contractIDs.find(contract);
+    if (it != m_contractIDs.end())
+    {
+        return it->second;
+    }
+
+    auto contractID = static_cast<ContractID>(m_contracts.size());
+    auto& stored = m_contracts.emplace_back(contract);
+    m_contractIDs.emplace(std::string_view(stored), contractID);
+
+    return contractID;
+}
+
+Interner::ContractID Interner::findContract(std::string_view contract) const
+{
+    auto it = m_contractIDs.find(contract);
+    if (it == m_contractIDs.end())
+    {
+        return INVALID_CONTRACT;
+    }
+
+    return it->second;
+}
+
+Interner::KeyLockID Interner::internKeyLock(ContractID contractID, std::string_view key)
+{
+    // Keep load factor under 0.5
+    if ((m_keyLocks.size() + 1) * 2 > m_slots.size())
+    {
+        rehash(std::max<size_t>(m_slots.size() * 2, 64));
+    }
+
+    auto hash = hashKeyLock(contractID, key);
+    auto mask = m_slots.size() - 1;
+    auto slot = hash & mask;
+    for (;; slot = (slot + 1) & mask)
+    {
+        auto keyLockID = m_slots[slot];
+        if (keyLockID == INVALID_KEY_LOCK)
+        {
+            break;
+        }
+
+        auto& entry = m_keyLocks[keyLockID];
+        if (entry.hash == hash && entry.contract == contractID && entry.key == key)
+        {
+            return keyLockID;
+        }
+    }
+
+    auto keyLockID = static_cast<KeyLockID>(m_keyLocks.size());
+    m_keyLocks.push_back(
+        KeyLockEntry{contractID, std::pmr::string(key, m_keyLocks.get_allocator()), hash});
+    m_slots[slot] = keyLockID;
+
+    return keyLockID;
+}
+
+Interner::KeyLockID Interner::findKeyLock(ContractID contractID, std::string_view key) const
+{
+    if (m_slots.empty())
+    {
+        return INVALID_KEY_LOCK;
+    }
+
+    auto hash = hashKeyLock(contractID, key);
+    auto mask = m_slots.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        auto keyLockID = m_slots[slot];
+        if (keyLockID == INVALID_KEY_LOCK)
+        {
+            return INVALID_KEY_LOCK;
+        }
+
+        auto& entry = m_keyLocks[keyLockID];
+        if (entry.hash == hash && entry.contract == contractID && entry.key == key)
+        {
+            return keyLockID;
+        }
+    }
+}
+
+size_t Interner::hashKeyLock(ContractID contractID, std::string_view key)
+{
+    auto seed = std::hash<std::string_view>{}(key);
+    seed ^= std::hash<ContractID>{}(contractID) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+void Interner::rehash(size_t slotCount)
+{
+    m_slots.assign(slotCount, INVALID_KEY_LOCK);
+    auto mask = slotCount - 1;
+    for (KeyLockID keyLockID = 0; keyLockID < m_keyLocks.size(); ++keyLockID)
+    {
+        auto slot = m_keyLocks[keyLockID].hash & mask;
+        while (m_slots[slot] != INVALID_KEY_LOCK)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = keyLockID;
+    }
+}
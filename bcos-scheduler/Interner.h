@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Block scoped identifiers of contracts and (contract, key) pairs
+// Every string is stored once, ids are dense and assigned in first seen order so they can index
+// vectors and be compared as integers. Storage comes from `resource`, e.g. the arena of the block.
+class Interner
+{
+public:
+    using Ptr = std::shared_ptr<Interner>;
+    using ContractID = uint32_t;
+    using KeyLockID = uint64_t;
+
+    static constexpr ContractID INVALID_CONTRACT = std::numeric_limits<ContractID>::max();
+    static constexpr KeyLockID INVALID_KEY_LOCK = std::numeric_limits<KeyLockID>::max();
+
+    explicit Interner(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_contracts(resource), m_contractIDs(resource), m_keyLocks(resource), m_slots(resource)
+    {}
+    Interner(const Interner&) = delete;
+    Interner(Interner&&) = delete;
+    Interner& operator=(const Interner&) = delete;
+    Interner& operator=(Interner&&) = delete;
+
+    ContractID internContract(std::string_view contract);
+    ContractID findContract(std::string_view contract) const;
+
+    KeyLockID internKeyLock(ContractID contractID, std::string_view key);
+    KeyLockID findKeyLock(ContractID contractID, std::string_view key) const;
+
+    std::string_view contract(ContractID contractID) const { return m_contracts[contractID]; }
+    ContractID contractOf(KeyLockID keyLockID) const { return m_keyLocks[keyLockID].contract; }
+    std::string_view key(KeyLockID keyLockID) const { return m_keyLocks[keyLockID].key; }
+
+    size_t contractCount() const { return m_contracts.size(); }
+    size_t keyLockCount() const { return m_keyLocks.size(); }
+
+private:
+    struct KeyLockEntry
+    {
+        ContractID contract;
+        std::pmr::string key;
+        size_t hash;
+    };
+
+    // Stable addresses for the views in m_contractIDs
+    std::pmr::deque<std::pmr::string> m_contracts;
+    std::pmr::unordered_map<std::string_view, ContractID> m_contractIDs;
+
+    // Open addressing with linear probing on (contract, key)
+    std::pmr::vector<KeyLockEntry> m_keyLocks;
+    std::pmr::vector<KeyLockID> m_slots;
+
+    static size_t hashKeyLock(ContractID contractID, std::string_view key);
+    void rehash(size_t slotCount);
+};
+
+}  // namespace bcos::scheduler
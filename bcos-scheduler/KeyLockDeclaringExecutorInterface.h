@@ -0,0 +1,29 @@
+#pragma once
+
+#include <bcos-framework/interfaces/executor/ExecutionMessage.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Optional interface of an executor knowing the keys a transaction locks at the contract it is
+// sent to before executing it, e.g. from the conflict fields of the contract's ABI. The scheduler
+// locks the declared keys exclusively before sending the transaction, writers with disjoint keys
+// then execute at the contract at once. The outermost frame of a declared transaction asks by
+// KEY_LOCK for any other key of the contract it touches, held by another context or not; a wrong
+// declaration waits for the key or is reverted on a dead lock as usual
+class KeyLockDeclaringExecutorInterface
+{
+public:
+    using Ptr = std::shared_ptr<KeyLockDeclaringExecutorInterface>;
+
+    virtual ~KeyLockDeclaringExecutorInterface() = default;
+
+    // Keys of the TXHASH message's transaction at its contract, none if unknown. Asked once per
+    // transaction without a round trip, before it is sent
+    virtual std::optional<std::vector<std::string>> declareKeyLocks(
+        const protocol::ExecutionMessage& transaction) = 0;
+};
+}  // namespace bcos::scheduler
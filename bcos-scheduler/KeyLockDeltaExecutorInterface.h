@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Common.h"
+#include "GraphKeyLocks.h"
+#include <bcos-framework/libutilities/Error.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Optional interface of an executor keeping a table of the conflicting key locks of each contract
+// and mode (see GraphKeyLocks::getConflictingKeyLocks) for the block. The scheduler sends the
+// changes since the version sent last instead of a list in every message, messages to the executor
+// carry no key locks: theirs are the keys of the table except the ones held by their context alone.
+// Tables start empty at every block
+class KeyLockDeltaExecutorInterface
+{
+public:
+    using Ptr = std::shared_ptr<KeyLockDeltaExecutorInterface>;
+
+    struct KeyLockDelta
+    {
+        std::string contract;
+        GraphKeyLocks::KeyLockMode mode;
+        uint64_t baseVersion = 0;  // Version of the table the changes apply to, 0 replaces it
+        uint64_t version = 0;
+        // Keys added or held by others, with the only holder or ConflictingKeyLocks::MANY_HOLDERS
+        std::vector<std::tuple<std::string, ContextID>> updates;
+        std::vector<std::string> removes;
+    };
+
+    virtual ~KeyLockDeltaExecutorInterface() = default;
+
+    // Messages relying on the changes are sent after the callback
+    virtual void updateKeyLocks(
+        std::vector<KeyLockDelta> deltas, std::function<void(Error::UniquePtr)> callback) = 0;
+};
+
+// Key lock data sent to executors, as lists in the messages or as changes of the tables
+struct KeyLockTransferStatistics
+{
+    std::atomic_size_t listBytes = 0;
+    std::atomic_size_t deltaBytes = 0;
+};
+}  // namespace bcos::scheduler
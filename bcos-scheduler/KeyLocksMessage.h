@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GraphKeyLocks.h"
+#include <bcos-framework/libexecutor/NativeExecutionMessage.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Native message referring to the conflicting key locks of its contract shared by every message
+// sent to the contract, instead of a list of its own. A context being the only holder of some of
+// the keys gets its own list without them
+class KeyLocksMessage : public bcos::executor::NativeExecutionMessage
+{
+public:
+    void setKeyLocks(
+        std::shared_ptr<const GraphKeyLocks::ConflictingKeyLocks> keyLocks, ContextID contextID)
+    {
+        if (!keyLocks->conflictsWithAll(contextID))
+        {
+            setKeyLocks(keyLocks->keysNotHoldingBy(contextID));
+            return;
+        }
+
+        NativeExecutionMessage::setKeyLocks({});
+        m_keyLocks = std::move(keyLocks);
+    }
+
+    gsl::span<std::string const> keyLocks() const override
+    {
+        return m_keyLocks ? gsl::span<std::string const>(m_keyLocks->keys) :
+                            NativeExecutionMessage::keyLocks();
+    }
+
+    std::vector<std::string> takeKeyLocks() override
+    {
+        if (!m_keyLocks)
+        {
+            return NativeExecutionMessage::takeKeyLocks();
+        }
+
+        auto keyLocks = m_keyLocks->keys;
+        m_keyLocks.reset();
+        return keyLocks;
+    }
+
+    void setKeyLocks(std::vector<std::string> keyLocks) override
+    {
+        m_keyLocks.reset();
+        NativeExecutionMessage::setKeyLocks(std::move(keyLocks));
+    }
+
+    // Whether the key locks are the shared list of the contract
+    bool sharesKeyLocks() const { return m_keyLocks != nullptr; }
+
+private:
+    std::shared_ptr<const GraphKeyLocks::ConflictingKeyLocks> m_keyLocks;
+};
+}  // namespace bcos::scheduler
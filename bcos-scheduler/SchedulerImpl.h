@@ -1,7 +1,11 @@
 #pragma once
 
+#include "BlockArena.h"
 #include "BlockExecutive.h"
+#include "DeadLockVictimPolicy.h"
+#include "ExecutionModeSelector.h"
 #include "ExecutorManager.h"
+#include "TransactionInputMessage.h"
 #include "bcos-framework/interfaces/dispatcher/SchedulerInterface.h"
 #include "bcos-framework/interfaces/ledger/LedgerInterface.h"
 #include "interfaces/crypto/CommonType.h"
@@ -11,6 +15,7 @@
 #include <bcos-framework/interfaces/protocol/BlockFactory.h>
 #include <bcos-framework/interfaces/rpc/RPCInterface.h>
 #include <tbb/concurrent_hash_map.h>
+#include <array>
 #include <list>
 
 namespace bcos::scheduler
@@ -74,6 +79,57 @@ public:
             bcos::protocol::TransactionSubmitResultsPtr, std::function<void(Error::Ptr)>)>
             txNotifier);
 
+    void setDeadLockVictimPolicy(DeadLockVictimPolicy policy) { m_deadLockVictimPolicy = policy; }
+    DeadLockVictimPolicy deadLockVictimPolicy() const { return m_deadLockVictimPolicy; }
+
+    void setDMTScheduleMode(DMTScheduleMode mode) { m_dmtScheduleMode = mode; }
+    DMTScheduleMode dmtScheduleMode() const { return m_dmtScheduleMode; }
+    // Mode the last block was executed in, after falling back from the set one
+    DMTScheduleMode lastScheduleMode() const { return m_lastScheduleMode; }
+
+    // Let blocks run in modes whose results depend on the executors' timing, only for a node out
+    // of consensus such as a benchmark. Static calls change no state and may always use them
+    void setNondeterministicScheduleAllowed(bool allowed)
+    {
+        m_nondeterministicScheduleAllowed = allowed;
+    }
+    bool nondeterministicScheduleAllowed() const { return m_nondeterministicScheduleAllowed; }
+
+    // Most read only (static call) messages, or writers of keys declared by their executor (see
+    // KeyLockDeclaringExecutorInterface), executing at one contract at once in DMT. Other writers
+    // always execute alone
+    void setContractInflightWindow(size_t window) { m_contractInflightWindow = window; }
+    size_t contractInflightWindow() const { return m_contractInflightWindow; }
+
+    // Critical path order ranks contracts by their pending messages only, every node dispatches
+    // the messages of a block in the same order
+    void setDMTDispatchOrder(DMTDispatchOrder order) { m_dmtDispatchOrder = order; }
+    DMTDispatchOrder dmtDispatchOrder() const { return m_dmtDispatchOrder; }
+
+    // Most DMT messages of a block executing at once, 0 for no limit. Messages over the limit are
+    // held by the scheduler, the dispatch order picks the next ones
+    void setDMTInflightLimit(size_t limit) { m_dmtInflightLimit = limit; }
+    size_t dmtInflightLimit() const { return m_dmtInflightLimit; }
+
+    const DeadLockVictimStatistics& deadLockVictimStatistics(DeadLockVictimPolicy policy) const
+    {
+        return m_deadLockVictimStatistics[static_cast<size_t>(policy)];
+    }
+
+    const BlockArenaStatistics& blockArenaStatistics() const { return m_blockArenaStatistics; }
+
+    const TransactionInputStatistics& transactionInputStatistics() const
+    {
+        return *m_transactionInputStatistics;
+    }
+
+    const KeyLockTransferStatistics& keyLockTransferStatistics() const
+    {
+        return m_keyLockTransferStatistics;
+    }
+
+    const ExecutionModeSelector& executionModeSelector() const { return m_executionModeSelector; }
+
 private:
     void asyncGetLedgerConfig(
         std::function<void(Error::Ptr, ledger::LedgerConfig::Ptr ledgerConfig)> callback);
@@ -97,6 +153,22 @@ private:
     bcos::crypto::Hash::Ptr m_hashImpl;
     bool m_isAuthCheck = false;
 
+    std::atomic<DeadLockVictimPolicy> m_deadLockVictimPolicy = DeadLockVictimPolicy::LOWEST_PROGRESS;
+    std::atomic<DMTScheduleMode> m_dmtScheduleMode = DMTScheduleMode::LOCK_STEP;
+    std::atomic<DMTScheduleMode> m_lastScheduleMode = DMTScheduleMode::LOCK_STEP;
+    std::atomic_bool m_nondeterministicScheduleAllowed = false;
+    std::atomic_size_t m_contractInflightWindow = 1;
+    std::atomic<DMTDispatchOrder> m_dmtDispatchOrder = DMTDispatchOrder::CONTRACT;
+    std::atomic_size_t m_dmtInflightLimit = 0;
+    std::array<DeadLockVictimStatistics, static_cast<size_t>(DeadLockVictimPolicy::COUNT)>
+        m_deadLockVictimStatistics;
+    BlockArenaStatistics m_blockArenaStatistics;
+    // Shared with the messages referring to the input
+    std::shared_ptr<TransactionInputStatistics> m_transactionInputStatistics =
+        std::make_shared<TransactionInputStatistics>();
+    KeyLockTransferStatistics m_keyLockTransferStatistics;
+    ExecutionModeSelector m_executionModeSelector;
+
     std::function<void(protocol::BlockNumber blockNumber)> m_blockNumberReceiver;
     std::function<void(bcos::protocol::BlockNumber, bcos::protocol::TransactionSubmitResultsPtr,
         std::function<void(Error::Ptr)>)>
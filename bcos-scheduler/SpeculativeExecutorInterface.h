@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Common.h"
+#include <bcos-framework/interfaces/executor/ExecutionMessage.h>
+#include <bcos-framework/libutilities/Error.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bcos::scheduler
+{
+// Optional interface of an executor running every contract, for DMTScheduleMode::OPTIMISTIC. A
+// speculation executes a whole transaction against the state of the speculations applied so far,
+// keeps its writes aside and reports the keys it read and wrote. The scheduler applies the valid
+// speculations in context order and speculates the conflicting transactions again
+class SpeculativeExecutorInterface
+{
+public:
+    using Ptr = std::shared_ptr<SpeculativeExecutorInterface>;
+
+    struct Speculation
+    {
+        protocol::ExecutionMessage::UniquePtr message;  // FINISHED or REVERT of the transaction
+        std::vector<std::string> reads;                 // Keys, unique across contracts
+        std::vector<std::string> writes;
+    };
+
+    virtual ~SpeculativeExecutorInterface() = default;
+
+    // Speculations are indexed as the inputs, the executor keeps the inputs for the block
+    virtual void speculateTransactions(std::vector<protocol::ExecutionMessage::UniquePtr> inputs,
+        std::function<void(Error::UniquePtr, std::vector<Speculation>)> callback) = 0;
+
+    // Speculate the kept transactions of the contexts again, replacing their last speculations
+    virtual void respeculateTransactions(std::vector<ContextID> contextIDs,
+        std::function<void(Error::UniquePtr, std::vector<Speculation>)> callback) = 0;
+
+    // Write the last speculations of the contexts to the state, in the order given
+    virtual void applySpeculations(
+        std::vector<ContextID> contextIDs, std::function<void(Error::UniquePtr)> callback) = 0;
+};
+}  // namespace bcos::scheduler
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "KeyLocksMessage.h"
+#include <bcos-framework/interfaces/protocol/Transaction.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace bcos::scheduler
+{
+// Transaction input of executed blocks referenced by messages and copied out of them
+struct TransactionInputStatistics
+{
+    std::atomic_size_t referencedBytes = 0;
+    std::atomic_size_t copiedBytes = 0;
+};
+
+// Native message whose data refers to the input of its transaction instead of a copy, the
+// transaction is kept alive by the message. The input is only copied if the data is taken, setting
+// new data drops the reference. Copies are counted in `statistics`, the message may outlive its
+// block in an executor
+class TransactionInputMessage : public KeyLocksMessage
+{
+public:
+    TransactionInputMessage(bcos::protocol::Transaction::ConstPtr transaction,
+        std::shared_ptr<TransactionInputStatistics> statistics)
+      : m_transaction(std::move(transaction)), m_statistics(std::move(statistics))
+    {}
+
+    bcos::bytesConstRef data() const override
+    {
+        return m_transaction ? m_transaction->input() : NativeExecutionMessage::data();
+    }
+
+    bcos::bytes takeData() override
+    {
+        if (!m_transaction)
+        {
+            return NativeExecutionMessage::takeData();
+        }
+
+        auto input = m_transaction->input();
+        m_statistics->copiedBytes += input.size();
+        m_transaction.reset();
+        return input.toBytes();
+    }
+
+    void setData(bcos::bytes data) override
+    {
+        m_transaction.reset();
+        NativeExecutionMessage::setData(std::move(data));
+    }
+
+private:
+    bcos::protocol::Transaction::ConstPtr m_transaction;
+    std::shared_ptr<TransactionInputStatistics> m_statistics;
+};
+}  // namespace bcos::scheduler
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "MockExecutor.h"
+#include "bcos-scheduler/BatchExecutorInterface.h"
+#include <bcos-framework/interfaces/executor/ParallelTransactionExecutorInterface.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// In process executor, every transaction is sent back m_steps - 1 times before it finishes.
+// Every call costs m_callCost as a round trip to a remote executor does
+class MockInProcessExecutor : public MockParallelExecutor
+{
+public:
+    MockInProcessExecutor(const std::string& name) : MockParallelExecutor(name) {}
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        roundTrip();
+        ++m_messages;
+        execute(*input);
+        callback(nullptr, std::move(input));
+    }
+
+    size_t m_steps = 4;
+    std::chrono::microseconds m_callCost{0};
+
+    std::atomic_size_t m_calls = 0;
+    std::atomic_size_t m_messages = 0;
+
+protected:
+    void roundTrip()
+    {
+        ++m_calls;
+        auto deadline = std::chrono::steady_clock::now() + m_callCost;
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+        }
+    }
+
+    void execute(bcos::protocol::ExecutionMessage& input)
+    {
+        size_t step = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            step = m_contextSteps[input.contextID()]++;
+        }
+
+        input.setStatus(0);
+        if (step + 1 < m_steps)
+        {
+            input.setType(bcos::protocol::ExecutionMessage::SEND_BACK);
+            return;
+        }
+
+        // The output replaces the input
+        std::string output = "OK!";
+        input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+        input.setData(bcos::bytes(output.begin(), output.end()));
+    }
+
+private:
+    std::mutex m_mutex;
+    std::map<int64_t, size_t> m_contextSteps;
+};
+
+// Takes the messages of a round in one call
+class MockBatchExecutor : public MockInProcessExecutor,
+                          public bcos::scheduler::BatchExecutorInterface
+{
+public:
+    MockBatchExecutor(const std::string& name) : MockInProcessExecutor(name) {}
+
+    void executeTransactions(std::vector<bcos::protocol::ExecutionMessage::UniquePtr> inputs,
+        std::function<void(
+            bcos::Error::UniquePtr, std::vector<bcos::protocol::ExecutionMessage::UniquePtr>)>
+            callback) override
+    {
+        roundTrip();
+        m_messages += inputs.size();
+        for (auto& input : inputs)
+        {
+            execute(*input);
+        }
+        callback(nullptr, std::move(inputs));
+    }
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
@@ -1,11 +1,14 @@
 #pragma once
 #include "MockExecutor.h"
 #include "interfaces/executor/ExecutionMessage.h"
+#include <boost/lexical_cast.hpp>
 
 namespace bcos::test
 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every pair of contexts (2n, 2n + 1) forms a dead lock: context 2n calls from contract(2n + 1) to
+// contract(2n + 2) and context 2n + 1 calls the other way, each holding the key the other waits
 class MockDeadLockParallelExecutor : public MockParallelExecutor
 {
 public:
@@ -17,101 +20,61 @@ public:
         std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
             callback) override
     {
-        std::set<std::string, std::less<>> contracts = {"contract1", "contract2"};
+        auto contextID = input->contextID();
+        BOOST_CHECK(contextID >= 0 && contextID < m_contextCount);
+
+        auto first = "contract" + boost::lexical_cast<std::string>(contextID / 2 * 2 + 1);
+        auto second = "contract" + boost::lexical_cast<std::string>(contextID / 2 * 2 + 2);
+        auto caller = contextID % 2 == 0 ? first : second;
+        auto callee = contextID % 2 == 0 ? second : first;
+        auto ownKey = contextID % 2 == 0 ? "key1" : "key2";
+        auto otherKey = contextID % 2 == 0 ? "key2" : "key1";
+
+        std::set<std::string, std::less<>> contracts = {first, second};
         BOOST_CHECK(contracts.count(input->to()) == 1);
-        BOOST_CHECK(input->contextID() == 0 || input->contextID() == 1);
 
         if (input->type() == protocol::ExecutionMessage::REVERT)
         {
-            if (input->contextID() == 1)
+            if (input->seq() == 1 || input->seq() == 0)
             {
-                if (input->seq() == 1)
-                {
-                    BOOST_CHECK_EQUAL(input->to(), "contract1");
-                    BOOST_CHECK_EQUAL(input->from(), "contract1");
-                }
-                else if (input->seq() == 0)
-                {
-                    BOOST_CHECK_EQUAL(input->to(), "contract1");
-                    BOOST_CHECK_EQUAL(input->from(), "contract1");
-                }
-                else
-                {
-                    BOOST_FAIL("Unexecuted seq");
-                }
+                BOOST_CHECK_EQUAL(input->to(), callee);
+                BOOST_CHECK_EQUAL(input->from(), callee);
             }
             else
             {
-                if (input->seq() == 1)
-                {
-                    BOOST_CHECK_EQUAL(input->to(), "contract2");
-                    BOOST_CHECK_EQUAL(input->from(), "contract2");
-                }
-                else if (input->seq() == 0)
-                {
-                    BOOST_CHECK_EQUAL(input->to(), "contract2");
-                    BOOST_CHECK_EQUAL(input->from(), "contract2");
-                }
-                else
-                {
-                    BOOST_FAIL("Unexecuted seq");
-                }
+                BOOST_FAIL("Unexecuted seq");
             }
         }
         else if (input->type() == protocol::ExecutionMessage::TXHASH)
         {
             BOOST_CHECK_EQUAL(input->seq(), 0);
+            BOOST_CHECK_EQUAL(input->to(), caller);
             input->setType(protocol::ExecutionMessage::MESSAGE);
-            if (input->to() == "contract1")
-            {
-                input->setFrom("contract1");
-                input->setTo("contract2");
-                input->setKeyLocks({"key1"});
-            }
-            else
-            {
-                input->setFrom("contract2");
-                input->setTo("contract1");
-                input->setKeyLocks({"key2"});
-            }
+            input->setFrom(caller);
+            input->setTo(callee);
+            input->setKeyLocks({ownKey});
         }
         else if (input->type() == protocol::ExecutionMessage::MESSAGE)
         {
             BOOST_CHECK_GT(input->seq(), 0);
             input->setType(protocol::ExecutionMessage::KEY_LOCK);
 
-            if (input->contextID() == 1)
-            {
-                BOOST_CHECK_EQUAL(input->keyLocks()[0], "key1");
-                input->setFrom(std::string(input->to()));
-                input->setKeyLocks({});
-                input->setKeyLockAcquired("key1");
-            }
-            else
-            {
-                BOOST_CHECK_EQUAL(input->keyLocks()[0], "key2");
-                input->setFrom(std::string(input->to()));
-                input->setKeyLocks({});
-                input->setKeyLockAcquired("key2");
-            }
+            BOOST_CHECK_EQUAL(input->keyLocks()[0], otherKey);
+            input->setFrom(std::string(input->to()));
+            input->setKeyLocks({});
+            input->setKeyLockAcquired(otherKey);
         }
         else if (input->type() == protocol::ExecutionMessage::KEY_LOCK)
         {
-            std::set<std::string, std::less<>> contracts = {"contract1", "contract2"};
-            BOOST_CHECK_EQUAL(contracts.count(input->to()), 1);
             input->setType(protocol::ExecutionMessage::FINISHED);
         }
-        else if (input->type() == protocol::ExecutionMessage::FINISHED)
-        {
-            std::set<std::string, std::less<>> contracts = {"contract1", "contract2"};
-            BOOST_CHECK_EQUAL(contracts.count(input->to()), 1);
-        }
 
         callback(nullptr, std::move(input));
     }
 
+    int64_t m_contextCount = 2;
     std::string m_name;
     bcos::protocol::BlockNumber m_blockNumber = 0;
 };
 #pragma GCC diagnostic pop
-}  // namespace bcos::test
\ No newline at end of file
+}  // namespace bcos::test
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "bcos-scheduler/Common.h"
+#include <boost/graph/adjacency_list.hpp>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace bcos::test
+{
+// The key locks of the graph implementation GraphKeyLocks replaced, kept as the baseline of its
+// performance tests: key and context vertexes indexed by a map, a key holding by a context is an
+// edge key -> context labelled with the seq, waiting is the edge context -> key
+class MockGraphKeyLocks
+{
+public:
+    bool acquireKeyLock(std::string_view contract, std::string_view key,
+        scheduler::ContextID contextID, scheduler::Seq seq)
+    {
+        auto keyVertex = touchKeyLock(contract, key);
+        auto contextVertex = touchContext(contextID);
+
+        auto range = boost::out_edges(keyVertex, m_graph);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (m_graph[boost::target(*it, m_graph)] != contextID)
+            {
+                addEdge(contextVertex, keyVertex, seq);
+                return false;
+            }
+        }
+
+        boost::remove_edge(contextVertex, keyVertex, m_graph);
+        addEdge(keyVertex, contextVertex, seq);
+        return true;
+    }
+
+    void releaseKeyLocks(scheduler::ContextID contextID, scheduler::Seq seq)
+    {
+        auto vertex = touchContext(contextID);
+        auto removeEdges = [this, seq](auto range) {
+            size_t total = 0;
+            size_t removed = 0;
+            for (auto next = range.first; range.first != range.second; range.first = next)
+            {
+                ++total;
+                ++next;
+                if (m_graph[*range.first] == seq)
+                {
+                    ++removed;
+                    boost::remove_edge(*range.first, m_graph);
+                }
+            }
+            return total == removed;
+        };
+
+        auto clearedIn = removeEdges(boost::in_edges(vertex, m_graph));
+        auto clearedOut = removeEdges(boost::out_edges(vertex, m_graph));
+        if (clearedIn && clearedOut)
+        {
+            boost::remove_vertex(vertex, m_graph);
+            m_contexts.erase(contextID);
+        }
+    }
+
+private:
+    // Vertexes are labelled with their context, -1 for keys, edges with the seq
+    using Graph = boost::adjacency_list<boost::multisetS, boost::multisetS, boost::bidirectionalS,
+        scheduler::ContextID, scheduler::Seq>;
+    using VertexID = Graph::vertex_descriptor;
+
+    VertexID touchContext(scheduler::ContextID contextID)
+    {
+        auto [it, inserted] = m_contexts.emplace(contextID, VertexID());
+        if (inserted)
+        {
+            it->second = boost::add_vertex(contextID, m_graph);
+        }
+        return it->second;
+    }
+
+    VertexID touchKeyLock(std::string_view contract, std::string_view key)
+    {
+        auto view = std::make_tuple(contract, key);
+        auto it = m_keys.lower_bound(view);
+        if (it != m_keys.end() && it->first == view)
+        {
+            return it->second;
+        }
+        return m_keys
+            .emplace_hint(it, std::make_tuple(std::string(contract), std::string(key)),
+                boost::add_vertex(-1, m_graph))
+            ->second;
+    }
+
+    void addEdge(VertexID source, VertexID target, scheduler::Seq seq)
+    {
+        auto range = boost::edge_range(source, target, m_graph);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (m_graph[*it] == seq)
+            {
+                return;
+            }
+        }
+        boost::add_edge(source, target, seq, m_graph);
+    }
+
+    Graph m_graph;
+    std::map<scheduler::ContextID, VertexID> m_contexts;
+    std::map<std::tuple<std::string, std::string>, VertexID, std::less<>> m_keys;
+};
+}  // namespace bcos::test
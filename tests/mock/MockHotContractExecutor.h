@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MockSkewedLatencyExecutor.h"
+#include <algorithm>
+#include <atomic>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every transaction makes a static call from its own contract to m_hotContract, then finishes.
+// Records the most static calls executing at the hot contract at once
+class MockHotContractExecutor : public MockSkewedLatencyExecutor
+{
+public:
+    MockHotContractExecutor(const std::string& name) : MockSkewedLatencyExecutor(name)
+    {
+        m_slowFactor = 1;
+    }
+
+    std::string m_hotContract = "hot";
+    std::atomic_size_t m_maxExecuting = 0;
+
+protected:
+    bool execute(bcos::protocol::ExecutionMessage& input, size_t step) override
+    {
+        input.setStatus(0);
+        if (input.type() == bcos::protocol::ExecutionMessage::TXHASH)
+        {
+            input.setType(bcos::protocol::ExecutionMessage::MESSAGE);
+            input.setFrom(std::string(input.to()));
+            input.setTo(m_hotContract);
+            input.setStaticCall(true);
+            input.setKeyLocks({});
+            return false;
+        }
+
+        if (input.to() == m_hotContract)
+        {
+            m_maxExecuting = std::max<size_t>(m_maxExecuting, ++m_executing);
+
+            auto caller = std::string(input.from());
+            input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+            input.setFrom(m_hotContract);
+            input.setTo(std::move(caller));
+            input.setStaticCall(false);
+            input.setKeyLocks({});
+            return false;
+        }
+
+        // The returned static call finishes the transaction at its caller
+        input.setFrom(std::string(input.to()));
+        return true;
+    }
+
+    void delivered(const bcos::protocol::ExecutionMessage& response) override
+    {
+        if (response.from() == m_hotContract)
+        {
+            --m_executing;
+        }
+    }
+
+private:
+    std::atomic_size_t m_executing = 0;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
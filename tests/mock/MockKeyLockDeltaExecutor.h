@@ -0,0 +1,180 @@
+#pragma once
+
+#include "MockExecutor.h"
+#include "bcos-scheduler/KeyLockDeltaExecutorInterface.h"
+#include <bcos-framework/interfaces/executor/ParallelTransactionExecutorInterface.h>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every transaction locks its own key of m_hotContract, calls a callee sending it back
+// m_calleeSteps times, then finishes at m_hotContract. Keys of the transactions away at their
+// callees pile up in the key locks of the messages to m_hotContract, which are recorded
+class MockHotKeyExecutor : public MockParallelExecutor
+{
+public:
+    MockHotKeyExecutor(const std::string& name) : MockParallelExecutor(name) {}
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        auto contextID = input->contextID();
+        input->setStatus(0);
+        if (input->to() == m_hotContract)
+        {
+            auto keyLocks = keyLocksOf(*input);
+            std::sort(keyLocks.begin(), keyLocks.end());
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                auto visit = m_hotVisits[contextID]++;
+                m_hotKeyLocks[{contextID, visit}] = std::move(keyLocks);
+            }
+
+            if (input->type() == bcos::protocol::ExecutionMessage::TXHASH)
+            {
+                input->setType(bcos::protocol::ExecutionMessage::MESSAGE);
+                input->setFrom(m_hotContract);
+                input->setTo("callee" + boost::lexical_cast<std::string>(contextID % 16));
+                input->setKeyLocks({"key" + boost::lexical_cast<std::string>(contextID)});
+            }
+            else
+            {
+                // The returned call finishes the transaction
+                std::string output = "OK!";
+                input->setType(bcos::protocol::ExecutionMessage::FINISHED);
+                input->setFrom(m_hotContract);
+                input->setKeyLocks({});
+                input->setData(bcos::bytes(output.begin(), output.end()));
+            }
+        }
+        else
+        {
+            size_t step = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                step = m_calleeVisits[contextID]++;
+            }
+
+            input->setKeyLocks({});
+            if (step + 1 < m_calleeSteps)
+            {
+                input->setType(bcos::protocol::ExecutionMessage::SEND_BACK);
+            }
+            else
+            {
+                input->setType(bcos::protocol::ExecutionMessage::FINISHED);
+                input->setFrom(std::string(input->to()));
+                input->setTo(m_hotContract);
+            }
+        }
+
+        callback(nullptr, std::move(input));
+    }
+
+    // Sorted key locks of the messages to m_hotContract by (context, visit)
+    std::map<std::tuple<int64_t, size_t>, std::vector<std::string>> hotKeyLocks()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_hotKeyLocks;
+    }
+
+    std::string m_hotContract = "hot";
+    size_t m_calleeSteps = 16;
+
+protected:
+    virtual std::vector<std::string> keyLocksOf(const bcos::protocol::ExecutionMessage& input)
+    {
+        auto keyLocks = input.keyLocks();
+        return std::vector<std::string>(keyLocks.begin(), keyLocks.end());
+    }
+
+    std::mutex m_mutex;
+
+private:
+    std::map<int64_t, size_t> m_hotVisits;
+    std::map<int64_t, size_t> m_calleeVisits;
+    std::map<std::tuple<int64_t, size_t>, std::vector<std::string>> m_hotKeyLocks;
+};
+
+// Keeps the key lock tables and rebuilds the key locks of every message from them
+class MockKeyLockDeltaExecutor : public MockHotKeyExecutor,
+                                 public bcos::scheduler::KeyLockDeltaExecutorInterface
+{
+public:
+    MockKeyLockDeltaExecutor(const std::string& name) : MockHotKeyExecutor(name) {}
+
+    void updateKeyLocks(std::vector<KeyLockDelta> deltas,
+        std::function<void(bcos::Error::UniquePtr)> callback) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (auto& delta : deltas)
+            {
+                auto& table = m_tables[{delta.contract, delta.mode}];
+                if (delta.baseVersion == 0)
+                {
+                    table.keys.clear();
+                }
+                else if (delta.baseVersion != table.version)
+                {
+                    ++m_versionMismatches;
+                }
+
+                for (auto& key : delta.removes)
+                {
+                    table.keys.erase(key);
+                }
+                for (auto& [key, holder] : delta.updates)
+                {
+                    table.keys[key] = holder;
+                }
+                table.version = delta.version;
+                ++m_deltas;
+            }
+        }
+        callback(nullptr);
+    }
+
+    size_t m_versionMismatches = 0;
+    size_t m_deltas = 0;
+    size_t m_keyLocksInMessages = 0;
+
+protected:
+    std::vector<std::string> keyLocksOf(const bcos::protocol::ExecutionMessage& input) override
+    {
+        auto mode = input.staticCall() ? bcos::scheduler::GraphKeyLocks::KeyLockMode::SHARED :
+                                         bcos::scheduler::GraphKeyLocks::KeyLockMode::EXCLUSIVE;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_keyLocksInMessages += input.keyLocks().size();
+
+        std::vector<std::string> keyLocks;
+        for (auto& [key, holder] : m_tables[{std::string(input.to()), mode}].keys)
+        {
+            if (holder != input.contextID())
+            {
+                keyLocks.push_back(key);
+            }
+        }
+        return keyLocks;
+    }
+
+private:
+    struct Table
+    {
+        uint64_t version = 0;
+        std::map<std::string, int64_t> keys;
+    };
+    std::map<std::tuple<std::string, bcos::scheduler::GraphKeyLocks::KeyLockMode>, Table> m_tables;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
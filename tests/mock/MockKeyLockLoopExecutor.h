@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MockSkewedLatencyExecutor.h"
+#include <atomic>
+#include <string>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every transaction finishes at once but the one of m_loopContext, which asks for the lock of
+// m_key of its contract every time it is sent, whether it was acquired or not
+class MockKeyLockLoopExecutor : public MockSkewedLatencyExecutor
+{
+public:
+    MockKeyLockLoopExecutor(const std::string& name) : MockSkewedLatencyExecutor(name)
+    {
+        m_slowFactor = 1;
+    }
+
+    int64_t m_loopContext = 3;
+    std::string m_key = "key";
+    std::atomic_size_t m_keyLockAsks = 0;
+
+protected:
+    bool execute(bcos::protocol::ExecutionMessage& input, size_t step) override
+    {
+        input.setStatus(0);
+        input.setFrom(std::string(input.to()));
+        input.setKeyLocks({});
+        if (input.contextID() == m_loopContext)
+        {
+            ++m_keyLockAsks;
+            input.setType(bcos::protocol::ExecutionMessage::KEY_LOCK);
+            input.setKeyLockAcquired(m_key);
+            return false;
+        }
+
+        input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+        return true;
+    }
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
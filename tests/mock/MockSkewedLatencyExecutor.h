@@ -0,0 +1,182 @@
+#pragma once
+
+#include "MockExecutor.h"
+#include <bcos-framework/interfaces/executor/ParallelTransactionExecutorInterface.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every transaction is sent back m_steps - 1 times before it finishes, responses are delivered by
+// a worker thread after a latency, one call of m_slowRatio is m_slowFactor times slower
+class MockSkewedLatencyExecutor : public MockParallelExecutor
+{
+public:
+    MockSkewedLatencyExecutor(const std::string& name)
+      : MockParallelExecutor(name), m_worker([this]() { deliver(); })
+    {}
+
+    ~MockSkewedLatencyExecutor() noexcept override { stop(); }
+
+    // Deliver the left responses and join the worker
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        if (m_worker.joinable())
+        {
+            m_worker.join();
+        }
+    }
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_start)
+        {
+            m_start = now;
+        }
+
+        auto contextID = input->contextID();
+        auto step = m_contextSteps[contextID]++;
+        auto latency = m_latency;
+        if ((contextID * 7 + step * 13) % m_slowRatio == 0)
+        {
+            latency *= m_slowFactor;
+        }
+
+        auto deadline = now + latency;
+        if (execute(*input, step))
+        {
+            m_latencies.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(deadline - *m_start));
+            m_finished.push_back(contextID);
+        }
+
+        m_responses.push(Response{deadline, m_sequence++,
+            [this, inputRaw = input.release(), callback = std::move(callback)]() {
+                delivered(*inputRaw);
+                callback(nullptr, bcos::protocol::ExecutionMessage::UniquePtr(inputRaw));
+            }});
+        lock.unlock();
+        m_condition.notify_all();
+    }
+
+    void call(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        executeTransaction(std::move(input), std::move(callback));
+    }
+
+    // Latency of every finished transaction from the first call of the block
+    std::vector<std::chrono::microseconds> latencies()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_latencies;
+    }
+
+    // Contexts in the order their transactions finished
+    std::vector<int64_t> finished()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_finished;
+    }
+
+    size_t m_steps = 4;
+    std::chrono::microseconds m_latency{200};
+    int64_t m_slowRatio = 20;
+    int64_t m_slowFactor = 20;
+
+protected:
+    // Turns the input into its response with the lock held, true if the transaction is finished
+    virtual bool execute(bcos::protocol::ExecutionMessage& input, size_t step)
+    {
+        if (step + 1 < m_steps)
+        {
+            input.setType(bcos::protocol::ExecutionMessage::SEND_BACK);
+            return false;
+        }
+
+        input.setStatus(0);
+        input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+        return true;
+    }
+
+    // Called on the worker before the response is delivered
+    virtual void delivered(const bcos::protocol::ExecutionMessage& response) {}
+
+private:
+    struct Response
+    {
+        std::chrono::steady_clock::time_point deadline;
+        size_t sequence;
+        std::function<void()> deliver;
+
+        bool operator<(const Response& rhs) const
+        {
+            return std::tie(deadline, sequence) > std::tie(rhs.deadline, rhs.sequence);
+        }
+    };
+
+    void deliver()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            if (m_responses.empty())
+            {
+                if (m_stop)
+                {
+                    return;
+                }
+                m_condition.wait(lock);
+                continue;
+            }
+
+            auto deadline = m_responses.top().deadline;
+            if (std::chrono::steady_clock::now() < deadline)
+            {
+                m_condition.wait_until(lock, deadline);
+                continue;
+            }
+
+            auto response = std::move(const_cast<Response&>(m_responses.top()));
+            m_responses.pop();
+
+            lock.unlock();
+            response.deliver();
+            lock.lock();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::priority_queue<Response> m_responses;
+    size_t m_sequence = 0;
+    bool m_stop = false;
+
+    std::optional<std::chrono::steady_clock::time_point> m_start;
+    std::map<int64_t, size_t> m_contextSteps;
+    std::vector<std::chrono::microseconds> m_latencies;
+    std::vector<int64_t> m_finished;
+
+    std::thread m_worker;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MockBatchExecutor.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Acknowledges the block header after m_nextBlockDelay on another thread, counts messages received
+// before that
+class MockSlowNextBlockExecutor : public MockInProcessExecutor
+{
+public:
+    MockSlowNextBlockExecutor(const std::string& name) : MockInProcessExecutor(name) {}
+
+    ~MockSlowNextBlockExecutor() noexcept override { stop(); }
+
+    void stop()
+    {
+        for (auto& thread : m_threads)
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+    }
+
+    void nextBlockHeader(const bcos::protocol::BlockHeader::ConstPtr& blockHeader,
+        std::function<void(bcos::Error::UniquePtr)> callback) override
+    {
+        m_acknowledged = false;
+        m_threads.emplace_back([this, blockHeader, callback = std::move(callback)]() {
+            std::this_thread::sleep_for(m_nextBlockDelay);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_acknowledgedTime = std::chrono::steady_clock::now();
+            }
+            m_acknowledged = true;
+            MockInProcessExecutor::nextBlockHeader(blockHeader, std::move(callback));
+        });
+    }
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        if (!m_acknowledged)
+        {
+            ++m_earlyMessages;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_firstMessageTime)
+            {
+                m_firstMessageTime = std::chrono::steady_clock::now();
+            }
+        }
+        MockInProcessExecutor::executeTransaction(std::move(input), std::move(callback));
+    }
+
+    std::chrono::milliseconds m_nextBlockDelay{0};
+    std::atomic_size_t m_earlyMessages = 0;
+
+    std::optional<std::chrono::steady_clock::time_point> m_acknowledgedTime;
+    std::optional<std::chrono::steady_clock::time_point> m_firstMessageTime;
+
+private:
+    std::atomic_bool m_acknowledged = false;
+    std::mutex m_mutex;
+    std::vector<std::thread> m_threads;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
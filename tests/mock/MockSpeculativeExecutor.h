@@ -0,0 +1,176 @@
+#pragma once
+
+#include "MockExecutor.h"
+#include "bcos-scheduler/SpeculativeExecutorInterface.h"
+#include <bcos-framework/interfaces/executor/ParallelTransactionExecutorInterface.h>
+#include <bcos-framework/libexecutor/NativeExecutionMessage.h>
+#include <boost/lexical_cast.hpp>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Keeps a state of counters, a transaction of context c at contract `to` reads the keys c * 7 and
+// c of the contract modulo m_keys, then writes their sum plus c + 1 to key c. Every tenth
+// transaction reverts without writing. The DMT executes on the state directly, speculations write
+// aside until applied
+class MockSpeculativeExecutor : public MockParallelExecutor,
+                                public bcos::scheduler::SpeculativeExecutorInterface
+{
+public:
+    MockSpeculativeExecutor(const std::string& name) : MockParallelExecutor(name) {}
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_executions;
+            auto [reads, writes] = execute(*input);
+            for (auto& [key, value] : writes)
+            {
+                m_state[key] = value;
+            }
+        }
+        callback(nullptr, std::move(input));
+    }
+
+    void speculateTransactions(std::vector<bcos::protocol::ExecutionMessage::UniquePtr> inputs,
+        std::function<void(bcos::Error::UniquePtr, std::vector<Speculation>)> callback) override
+    {
+        std::vector<Speculation> speculations;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (auto& input : inputs)
+            {
+                auto contextID = input->contextID();
+                m_inputs[contextID] = std::move(input);
+                speculations.push_back(speculate(contextID));
+            }
+        }
+        callback(nullptr, std::move(speculations));
+    }
+
+    void respeculateTransactions(std::vector<bcos::scheduler::ContextID> contextIDs,
+        std::function<void(bcos::Error::UniquePtr, std::vector<Speculation>)> callback) override
+    {
+        std::vector<Speculation> speculations;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (auto contextID : contextIDs)
+            {
+                speculations.push_back(speculate(contextID));
+            }
+        }
+        callback(nullptr, std::move(speculations));
+    }
+
+    void applySpeculations(std::vector<bcos::scheduler::ContextID> contextIDs,
+        std::function<void(bcos::Error::UniquePtr)> callback) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (auto contextID : contextIDs)
+            {
+                for (auto& [key, value] : m_pendingWrites[contextID])
+                {
+                    m_state[key] = value;
+                }
+                m_pendingWrites.erase(contextID);
+            }
+        }
+        callback(nullptr);
+    }
+
+    void getHash(bcos::protocol::BlockNumber number,
+        std::function<void(bcos::Error::UniquePtr, crypto::HashType)> callback) override
+    {
+        size_t hash = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (auto& [key, value] : m_state)
+            {
+                hash = hash * 31 + std::hash<std::string>()(key + "=" + std::to_string(value));
+            }
+        }
+        callback(nullptr, h256(hash));
+    }
+
+    size_t m_keys = 8;
+    size_t m_executions = 0;
+    size_t m_speculations = 0;
+
+private:
+    using Writes = std::vector<std::tuple<std::string, int64_t>>;
+
+    // Reads and writes of the transaction on m_state, the message becomes its result
+    std::tuple<std::vector<std::string>, Writes> execute(bcos::protocol::ExecutionMessage& input)
+    {
+        auto contextID = input.contextID();
+        auto key = [this, &input](int64_t index) {
+            return std::string(input.to()) + "/" + boost::lexical_cast<std::string>(index % m_keys);
+        };
+
+        std::vector<std::string> reads{key(contextID * 7), key(contextID)};
+        int64_t sum = contextID + 1;
+        for (auto& read : reads)
+        {
+            auto it = m_state.find(read);
+            sum += it != m_state.end() ? it->second : 0;
+        }
+
+        Writes writes;
+        auto output = boost::lexical_cast<std::string>(sum);
+        if (contextID % 10 == 9)
+        {
+            input.setStatus(1);
+            input.setType(bcos::protocol::ExecutionMessage::REVERT);
+        }
+        else
+        {
+            input.setStatus(0);
+            input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+            writes.emplace_back(key(contextID), sum);
+        }
+        input.setData(bcos::bytes(output.begin(), output.end()));
+        return {std::move(reads), std::move(writes)};
+    }
+
+    Speculation speculate(bcos::scheduler::ContextID contextID)
+    {
+        ++m_speculations;
+
+        // The kept input stays for the next speculation, the result goes in a copy
+        auto& input = m_inputs[contextID];
+        auto message = std::make_unique<bcos::executor::NativeExecutionMessage>();
+        message->setContextID(contextID);
+        message->setTo(std::string(input->to()));
+        message->setTransactionHash(input->transactionHash());
+        message->setGasAvailable(input->gasAvailable());
+
+        auto [reads, writes] = execute(*message);
+        Speculation speculation;
+        speculation.reads = std::move(reads);
+        for (auto& [key, value] : writes)
+        {
+            speculation.writes.push_back(key);
+        }
+        m_pendingWrites[contextID] = std::move(writes);
+        speculation.message = std::move(message);
+        return speculation;
+    }
+
+    std::mutex m_mutex;
+    std::map<std::string, int64_t> m_state;
+    std::map<bcos::scheduler::ContextID, bcos::protocol::ExecutionMessage::UniquePtr> m_inputs;
+    std::map<bcos::scheduler::ContextID, Writes> m_pendingWrites;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "MockSkewedLatencyExecutor.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Context 0 writes m_key of m_contract, then static calls m_callee, which returns with its static
+// flag. Every other context static calls m_contract from its own contract and reads m_readKey,
+// asking for its lock if another holds it. Records the reads while the writer holds m_key, of the
+// written key or another one, and the writer resumed next to executing readers
+class MockStaticCallWriterExecutor : public MockSkewedLatencyExecutor
+{
+public:
+    MockStaticCallWriterExecutor(const std::string& name) : MockSkewedLatencyExecutor(name)
+    {
+        m_slowFactor = 1;
+    }
+
+    std::string m_contract = "shared";
+    std::string m_callee = "callee";
+    std::string m_key = "key";
+    std::string m_readKey = m_key;
+    std::atomic_size_t m_dirtyReads = 0;
+    std::atomic_size_t m_readsNextToWriter = 0;
+    std::atomic_size_t m_maxReading = 0;
+    std::atomic_size_t m_overlaps = 0;
+
+protected:
+    bool execute(bcos::protocol::ExecutionMessage& input, size_t step) override
+    {
+        input.setStatus(0);
+        if (input.contextID() == 0)
+        {
+            return write(input);
+        }
+
+        if (input.type() == bcos::protocol::ExecutionMessage::TXHASH)
+        {
+            m_callers[input.contextID()] = std::string(input.to());
+            input.setType(bcos::protocol::ExecutionMessage::MESSAGE);
+            input.setFrom(std::string(input.to()));
+            input.setTo(m_contract);
+            input.setStaticCall(true);
+            input.setKeyLocks({});
+            return false;
+        }
+
+        if (input.to() == m_contract)
+        {
+            auto keyLocks = input.keyLocks();
+            if (std::find(keyLocks.begin(), keyLocks.end(), m_readKey) != keyLocks.end())
+            {
+                input.setType(bcos::protocol::ExecutionMessage::KEY_LOCK);
+                input.setFrom(m_contract);
+                input.setKeyLocks({});
+                input.setKeyLockAcquired(m_readKey);
+                return false;
+            }
+
+            m_maxReading = std::max(m_maxReading.load(), ++m_reading);
+            if (m_writing)
+            {
+                ++(m_readKey == m_key ? m_dirtyReads : m_readsNextToWriter);
+            }
+
+            input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+            input.setFrom(m_contract);
+            input.setTo(m_callers[input.contextID()]);
+            input.setKeyLocks({});
+            return false;
+        }
+
+        // The returned static call finishes the transaction at its caller
+        input.setFrom(std::string(input.to()));
+        return true;
+    }
+
+    void delivered(const bcos::protocol::ExecutionMessage& response) override
+    {
+        if (response.contextID() != 0 && response.from() == m_contract &&
+            response.type() == bcos::protocol::ExecutionMessage::FINISHED)
+        {
+            --m_reading;
+        }
+    }
+
+private:
+    bool write(bcos::protocol::ExecutionMessage& input)
+    {
+        if (input.type() == bcos::protocol::ExecutionMessage::TXHASH)
+        {
+            m_writing = true;
+            input.setType(bcos::protocol::ExecutionMessage::MESSAGE);
+            input.setFrom(m_contract);
+            input.setTo(m_callee);
+            input.setStaticCall(true);
+            input.setKeyLocks({m_key});
+            return false;
+        }
+
+        if (input.to() == m_callee)
+        {
+            input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+            input.setFrom(m_callee);
+            input.setTo(m_contract);
+            input.setKeyLocks({});
+            return false;
+        }
+
+        if (m_reading > 0)
+        {
+            ++m_overlaps;
+        }
+        m_writing = false;
+        input.setFrom(m_contract);
+        return true;
+    }
+
+    std::map<int64_t, std::string> m_callers;
+    std::atomic_size_t m_reading = 0;
+    std::atomic_bool m_writing = false;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
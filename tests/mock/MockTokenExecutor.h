@@ -0,0 +1,143 @@
+#pragma once
+
+#include "MockSkewedLatencyExecutor.h"
+#include "bcos-scheduler/KeyLockDeclaringExecutorInterface.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Every transaction transfers one from an account of the token contract it is sent to to another,
+// both declared as its keys if m_declaring. One in m_feeRatio also pays one into m_feeAccount,
+// which is never declared. Keys are asked for by KEY_LOCK as the scheduler requires. Records the
+// most messages executing at once and the messages touching an account another executing one
+// touches
+class MockTokenExecutor : public MockSkewedLatencyExecutor,
+                          public scheduler::KeyLockDeclaringExecutorInterface
+{
+public:
+    MockTokenExecutor(const std::string& name) : MockSkewedLatencyExecutor(name)
+    {
+        m_slowFactor = 1;
+    }
+
+    bool m_declaring = true;
+    int64_t m_accounts = 1024;
+    int64_t m_feeRatio = 0;  // No fee if 0
+    std::string m_feeAccount = "fee";
+    std::atomic_size_t m_maxExecuting = 0;
+    std::atomic_size_t m_races = 0;
+
+    std::optional<std::vector<std::string>> declareKeyLocks(
+        const bcos::protocol::ExecutionMessage& transaction) override
+    {
+        if (!m_declaring)
+        {
+            return std::nullopt;
+        }
+
+        std::unique_lock<std::mutex> lock(m_tokenMutex);
+        m_declared.insert(transaction.contextID());
+        return std::vector<std::string>{from(transaction.contextID()), to(transaction.contextID())};
+    }
+
+    std::map<std::string, int64_t> balances()
+    {
+        std::unique_lock<std::mutex> lock(m_tokenMutex);
+        return m_balances;
+    }
+
+protected:
+    bool execute(bcos::protocol::ExecutionMessage& input, size_t step) override
+    {
+        std::unique_lock<std::mutex> lock(m_tokenMutex);
+        m_maxExecuting = std::max<size_t>(m_maxExecuting, ++m_executing);
+
+        auto contextID = input.contextID();
+        auto& acquired = m_acquired[contextID];
+        if (input.type() == bcos::protocol::ExecutionMessage::KEY_LOCK)
+        {
+            acquired.insert(std::string(input.keyLockAcquired()));
+        }
+
+        std::vector<std::string> keys{from(contextID), to(contextID)};
+        if (m_feeRatio > 0 && contextID % m_feeRatio == 0)
+        {
+            keys.push_back(m_feeAccount);
+        }
+
+        // A declared transfer asks for every key it did not declare, others for the held ones
+        bool declared = m_declared.count(contextID) > 0;
+        auto keyLocks = input.keyLocks();
+        input.setStatus(0);
+        input.setFrom(std::string(input.to()));
+        input.setKeyLocks({});
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            bool held = std::find(keyLocks.begin(), keyLocks.end(), keys[i]) != keyLocks.end();
+            if ((declared ? i >= 2 : held) && acquired.count(keys[i]) == 0)
+            {
+                input.setType(bcos::protocol::ExecutionMessage::KEY_LOCK);
+                input.setKeyLockAcquired(keys[i]);
+                return false;
+            }
+        }
+
+        for (auto& key : keys)
+        {
+            if (m_touching[key]++ > 0)
+            {
+                ++m_races;
+            }
+        }
+        m_balances[keys[0]] -= static_cast<int64_t>(keys.size()) - 1;
+        for (size_t i = 1; i < keys.size(); ++i)
+        {
+            ++m_balances[keys[i]];
+        }
+        m_touched[contextID] = std::move(keys);
+
+        input.setType(bcos::protocol::ExecutionMessage::FINISHED);
+        return true;
+    }
+
+    void delivered(const bcos::protocol::ExecutionMessage& response) override
+    {
+        std::unique_lock<std::mutex> lock(m_tokenMutex);
+        --m_executing;
+        if (response.type() == bcos::protocol::ExecutionMessage::FINISHED)
+        {
+            for (auto& key : m_touched[response.contextID()])
+            {
+                --m_touching[key];
+            }
+        }
+    }
+
+private:
+    std::string from(int64_t contextID) const
+    {
+        return "account" + std::to_string((contextID * 2) % m_accounts);
+    }
+    std::string to(int64_t contextID) const
+    {
+        return "account" + std::to_string((contextID * 2 + 1) % m_accounts);
+    }
+
+    std::mutex m_tokenMutex;
+    size_t m_executing = 0;
+    std::set<int64_t> m_declared;
+    std::map<int64_t, std::set<std::string>> m_acquired;
+    std::map<int64_t, std::vector<std::string>> m_touched;
+    std::map<std::string, size_t> m_touching;
+    std::map<std::string, int64_t> m_balances;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "MockExecutor.h"
+#include <bcos-framework/interfaces/executor/ParallelTransactionExecutorInterface.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bcos::test
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Executes messages on m_workers threads in arrival order, a message of a contract takes its cost
+// in m_costs or m_defaultCost. Every transaction finishes at its first message
+class MockWorkerPoolExecutor : public MockParallelExecutor
+{
+public:
+    MockWorkerPoolExecutor(const std::string& name, size_t workers) : MockParallelExecutor(name)
+    {
+        for (size_t i = 0; i < workers; ++i)
+        {
+            m_workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~MockWorkerPoolExecutor() noexcept override { stop(); }
+
+    // Execute the left messages and join the workers
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+    }
+
+    void executeTransaction(bcos::protocol::ExecutionMessage::UniquePtr input,
+        std::function<void(bcos::Error::UniquePtr, bcos::protocol::ExecutionMessage::UniquePtr)>
+            callback) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_maxPending = std::max(m_maxPending, ++m_pending);
+            m_dispatched.push_back(input->contextID());
+            m_messages.push_back(
+                [this, inputRaw = input.release(), callback = std::move(callback)]() {
+                    bcos::protocol::ExecutionMessage::UniquePtr message(inputRaw);
+                    auto it = m_costs.find(std::string(message->to()));
+                    std::this_thread::sleep_for(it != m_costs.end() ? it->second : m_defaultCost);
+
+                    std::string output = "OK!";
+                    message->setStatus(0);
+                    message->setType(bcos::protocol::ExecutionMessage::FINISHED);
+                    message->setData(bcos::bytes(output.begin(), output.end()));
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        --m_pending;
+                    }
+                    callback(nullptr, std::move(message));
+                });
+        }
+        m_condition.notify_one();
+    }
+
+    std::map<std::string, std::chrono::microseconds> m_costs;
+    std::chrono::microseconds m_defaultCost{100};
+
+    // Most messages queued or executing at once
+    size_t maxPending()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_maxPending;
+    }
+
+    // Contexts of the messages in arrival order
+    std::vector<int64_t> dispatched()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_dispatched;
+    }
+
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            if (m_messages.empty())
+            {
+                if (m_stop)
+                {
+                    return;
+                }
+                m_condition.wait(lock);
+                continue;
+            }
+
+            auto message = std::move(m_messages.front());
+            m_messages.pop_front();
+
+            lock.unlock();
+            message();
+            lock.lock();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_messages;
+    bool m_stop = false;
+    size_t m_pending = 0;
+    size_t m_maxPending = 0;
+    std::vector<int64_t> m_dispatched;
+    std::vector<std::thread> m_workers;
+};
+#pragma GCC diagnostic pop
+}  // namespace bcos::test
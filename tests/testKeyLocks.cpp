@@ -1,13 +1,21 @@
+#include "../bcos-scheduler/BlockArena.h"
 #include "../bcos-scheduler/GraphKeyLocks.h"
+#include "../bcos-scheduler/Interner.h"
+#include "../bcos-scheduler/KeyLocksMessage.h"
 #include "libutilities/Common.h"
 #include "mock/MockExecutor.h"
+#include "mock/MockGraphKeyLocks.h"
 #include <boost/lexical_cast.hpp>
 #include <boost/test/tools/old/interface.hpp>
 #include <boost/test/unit_test.hpp>
+#include <chrono>
 #include <memory>
+#include <set>
 
 namespace bcos::test
 {
+constexpr auto LOWEST_PROGRESS = scheduler::DeadLockVictimPolicy::LOWEST_PROGRESS;
+
 struct KeyLocksFixture
 {
     KeyLocksFixture() {}
@@ -79,6 +87,337 @@ BOOST_AUTO_TEST_CASE(getKeyLocksNotHoldingByContext)
     BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), matchKeys.begin(), matchKeys.end());
 }
 
+BOOST_AUTO_TEST_CASE(keyLocksSnapshot)
+{
+    std::string to = "contract1";
+
+    BOOST_CHECK(keyLocks.getKeyLocksSnapshot(to)->empty());
+
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 100, 1));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 101, 1));
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract2", "key3", 102, 1));
+
+    auto snapshot = keyLocks.getKeyLocksSnapshot(to);
+    BOOST_CHECK_EQUAL(snapshot->size(), 2);
+    BOOST_CHECK_EQUAL((*snapshot)[0].key, "key1");
+    BOOST_CHECK_EQUAL((*snapshot)[0].contextID, 101);
+    BOOST_CHECK_EQUAL((*snapshot)[1].key, "key2");
+    BOOST_CHECK_EQUAL((*snapshot)[1].contextID, 100);
+
+    // Unchanged lock set share the snapshot
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key1", 100, 2));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 100, 2));
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract2", "key4", 102, 1));
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksSnapshot(to).get(), snapshot.get());
+
+    // Release one of the holding seqs, still holding
+    keyLocks.releaseKeyLocks(100, 1);
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksSnapshot(to).get(), snapshot.get());
+
+    keyLocks.releaseKeyLocks(100, 2);
+    auto newSnapshot = keyLocks.getKeyLocksSnapshot(to);
+    BOOST_CHECK_NE(newSnapshot.get(), snapshot.get());
+    BOOST_CHECK_EQUAL(newSnapshot->size(), 1);
+    BOOST_CHECK_EQUAL((*newSnapshot)[0].key, "key1");
+    BOOST_CHECK_EQUAL(snapshot->size(), 2);
+
+    BOOST_CHECK(keyLocks.getKeyLocksNotHoldingByContext(to, 101).empty());
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksNotHoldingByContext(to, 100).size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(conflictingKeyLocks)
+{
+    using Mode = scheduler::GraphKeyLocks::KeyLockMode;
+    using ConflictingKeyLocks = scheduler::GraphKeyLocks::ConflictingKeyLocks;
+    std::string to = "contract1";
+
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 100, 0, Mode::SHARED));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 101, 0, Mode::SHARED));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 102, 0, Mode::EXCLUSIVE));
+
+    auto writing = keyLocks.getConflictingKeyLocks(to);
+    BOOST_CHECK_EQUAL(writing->keys.size(), 2);
+    BOOST_CHECK_EQUAL(writing->keys[0], "key1");
+    BOOST_CHECK_EQUAL(writing->holders[0], ConflictingKeyLocks::MANY_HOLDERS);
+    BOOST_CHECK_EQUAL(writing->keys[1], "key2");
+    BOOST_CHECK_EQUAL(writing->holders[1], 102);
+    BOOST_CHECK(writing->conflictsWithAll(100));
+    BOOST_CHECK(!writing->conflictsWithAll(102));
+    BOOST_CHECK_EQUAL(writing->keysNotHoldingBy(102).size(), 1);
+
+    auto reading = keyLocks.getConflictingKeyLocks(to, Mode::SHARED);
+    BOOST_CHECK_EQUAL(reading->keys.size(), 1);
+    BOOST_CHECK_EQUAL(reading->keys[0], "key2");
+
+    // Messages to the contract refer to one list, the only holder of a key gets its own
+    scheduler::KeyLocksMessage message;
+    message.setKeyLocks(writing, 100);
+    BOOST_CHECK(message.sharesKeyLocks());
+    BOOST_CHECK_EQUAL(message.keyLocks().data(), writing->keys.data());
+
+    scheduler::KeyLocksMessage holderMessage;
+    holderMessage.setKeyLocks(writing, 102);
+    BOOST_CHECK(!holderMessage.sharesKeyLocks());
+    BOOST_CHECK_EQUAL(holderMessage.keyLocks().size(), 1);
+    BOOST_CHECK_EQUAL(holderMessage.keyLocks()[0], "key1");
+
+    auto taken = message.takeKeyLocks();
+    BOOST_CHECK_EQUAL(taken.size(), 2);
+    BOOST_CHECK(!message.sharesKeyLocks());
+    BOOST_CHECK_EQUAL(writing->keys.size(), 2);
+
+    // Cached until the lock set changes
+    BOOST_CHECK_EQUAL(keyLocks.getConflictingKeyLocks(to).get(), writing.get());
+    keyLocks.releaseAllKeyLocks(102);
+    auto released = keyLocks.getConflictingKeyLocks(to);
+    BOOST_CHECK_NE(released.get(), writing.get());
+    BOOST_CHECK_EQUAL(released->keys.size(), 1);
+    BOOST_CHECK(keyLocks.getConflictingKeyLocks(to, Mode::SHARED)->keys.empty());
+}
+
+BOOST_AUTO_TEST_CASE(acquireKeyLocks)
+{
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract1", "key1", 100, 1));
+
+    std::vector<scheduler::GraphKeyLocks::KeyLockRequest> requests{
+        {"contract1", "key2", 101, 1},
+        {"contract1", "key1", 101, 1},  // Held by 100
+        {"contract2", "key1", 101, 1},
+        {"contract1", "key2", 102, 1},  // Granted to 101 by the first request
+        {"contract1", "key1", 100, 2},
+        {"contract1", "key3", 102, 1},
+    };
+
+    auto grants = keyLocks.acquireKeyLocks(requests);
+    BOOST_CHECK_EQUAL(grants.granted.size(), requests.size());
+    BOOST_CHECK(grants.granted[0]);
+    BOOST_CHECK(!grants.granted[1]);
+    BOOST_CHECK(grants.granted[2]);
+    BOOST_CHECK(!grants.granted[3]);
+    BOOST_CHECK(grants.granted[4]);
+    BOOST_CHECK(grants.granted[5]);
+
+    BOOST_CHECK_EQUAL(grants.denials.size(), 2);
+    BOOST_CHECK_EQUAL(grants.denials[0].request, 1);
+    BOOST_CHECK_EQUAL(grants.denials[0].holder, 100);
+    BOOST_CHECK_EQUAL(grants.denials[1].request, 3);
+    BOOST_CHECK_EQUAL(grants.denials[1].holder, 101);
+
+    // Denied requests wait for the holders
+    BOOST_CHECK(!keyLocks.acquireKeyLock("contract1", "key3", 100, 3));
+    BOOST_CHECK(keyLocks.detectDeadLock(100));
+
+    std::vector<std::string> keys{"key4", "key3"};
+    BOOST_CHECK_THROW(keyLocks.batchAcquireKeyLock("contract1", keys, 103, 1), bcos::Error);
+}
+
+BOOST_AUTO_TEST_CASE(releaseAllKeyLocks)
+{
+    std::string to = "contract1";
+
+    // Interleaved seqs of a call stack
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 100, 0));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 100, 1));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key3", 100, 0));
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract2", "key4", 100, 2));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key5", 100, 1));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key1", 101, 0));
+
+    // Only the locks of seq 1 are released
+    keyLocks.releaseKeyLocks(100, 1);
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksSnapshot(to)->size(), 2);
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 101, 0));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key5", 101, 0));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key3", 101, 0));
+
+    keyLocks.releaseAllKeyLocks(100);
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksSnapshot(to)->size(), 2);
+    BOOST_CHECK(keyLocks.getKeyLocksSnapshot("contract2")->empty());
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 101, 0));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key3", 101, 0));
+    BOOST_CHECK(keyLocks.getKeyLocksNotHoldingByContext(to, 101).empty());
+
+    // Released context can acquire again
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract2", "key4", 100, 0));
+    keyLocks.releaseAllKeyLocks(101);
+    BOOST_CHECK(keyLocks.getKeyLocksSnapshot(to)->empty());
+}
+
+BOOST_AUTO_TEST_CASE(tryBatchAcquireKeyLock)
+{
+    std::string to = "contract1";
+    std::vector<std::string> keys{"key1", "key2", "key3"};
+
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 100, 0));
+    BOOST_CHECK(!keyLocks.tryBatchAcquireKeyLock(to, keys, 101, 0));
+
+    // Nothing is held or waited for after a failure
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksSnapshot(to)->size(), 1);
+    BOOST_CHECK(!keyLocks.detectDeadLock(101));
+    BOOST_CHECK(keyLocks.tryBatchAcquireKeyLock(to, keys, 100, 1));
+
+    keyLocks.releaseAllKeyLocks(100);
+    BOOST_CHECK(keyLocks.tryBatchAcquireKeyLock(to, keys, 101, 0));
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksNotHoldingByContext(to, 100).size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(sharedKeyLock)
+{
+    using Mode = scheduler::GraphKeyLocks::KeyLockMode;
+    std::string to = "contract1";
+
+    // Readers share the key
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 100, 0, Mode::SHARED));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 101, 0, Mode::SHARED));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key1", 102, 0, Mode::EXCLUSIVE));
+
+    auto snapshot = keyLocks.getKeyLocksSnapshot(to);
+    BOOST_CHECK_EQUAL(snapshot->size(), 2);
+    BOOST_CHECK_EQUAL((*snapshot)[0].contextID, 100);
+    BOOST_CHECK_EQUAL((*snapshot)[1].contextID, 101);
+
+    // A reader isn't told about shared keys, a writer is
+    BOOST_CHECK(keyLocks.getKeyLocksNotHoldingByContext(to, 102, Mode::SHARED).empty());
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksNotHoldingByContext(to, 102).size(), 1);
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksNotHoldingByContext(to, 100).size(), 1);
+
+    // Writer blocks readers
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 102, 0, Mode::EXCLUSIVE));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key2", 100, 0, Mode::SHARED));
+    BOOST_CHECK_EQUAL(keyLocks.getKeyLocksNotHoldingByContext(to, 100, Mode::SHARED).size(), 1);
+
+    // 102 waits for both readers, 100 waits for 102
+    BOOST_CHECK(keyLocks.detectDeadLock(100));
+    BOOST_CHECK(keyLocks.detectDeadLock(102));
+    BOOST_CHECK(!keyLocks.detectDeadLock(101));
+
+    keyLocks.releaseAllKeyLocks(100);
+    BOOST_CHECK(!keyLocks.detectDeadLock(102));
+
+    // Upgrade of the only reader
+    keyLocks.releaseAllKeyLocks(102);
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 101, 0, Mode::EXCLUSIVE));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key1", 100, 0, Mode::SHARED));
+    keyLocks.releaseKeyLocks(101, 0);
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 100, 0, Mode::SHARED));
+}
+
+BOOST_AUTO_TEST_CASE(acquireKeyLocksByShard)
+{
+    // Large batches are served in parallel on the block's arena, results must match one by one and
+    // one pass acquisition
+    int64_t contractCount = 300;
+    int64_t contextCount = 2000;
+    int64_t keyCount = 8;
+
+    std::vector<std::string> contracts;
+    for (int64_t i = 0; i < contractCount; ++i)
+    {
+        contracts.emplace_back("contract" + boost::lexical_cast<std::string>(i));
+    }
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < 32; ++i)
+    {
+        keys.emplace_back("key" + boost::lexical_cast<std::string>(i));
+    }
+
+    std::vector<scheduler::GraphKeyLocks::KeyLockRequest> requests;
+    for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+    {
+        // One contract per context as in a batch
+        auto& contract = contracts[(contextID * 7) % contractCount];
+        for (int64_t i = 0; i < keyCount; ++i)
+        {
+            requests.push_back({contract, keys[(contextID + i * 5) % keys.size()], contextID, 0,
+                i % 2 ? scheduler::GraphKeyLocks::KeyLockMode::SHARED :
+                        scheduler::GraphKeyLocks::KeyLockMode::EXCLUSIVE});
+        }
+    }
+
+    scheduler::GraphKeyLocks serialKeyLocks;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<bool> serialGranted;
+    for (auto& request : requests)
+    {
+        serialGranted.push_back(serialKeyLocks.acquireKeyLock(
+            request.contract, request.key, request.contextID, request.seq, request.mode));
+    }
+    auto serialElapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    scheduler::GraphKeyLocks unshardedKeyLocks;
+    unshardedKeyLocks.setParallelAcquireSize(std::numeric_limits<size_t>::max());
+    start = std::chrono::steady_clock::now();
+    auto unshardedGrants = unshardedKeyLocks.acquireKeyLocks(requests);
+    auto unshardedElapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    scheduler::BlockArena arena;
+    scheduler::GraphKeyLocks shardedKeyLocks(std::make_shared<scheduler::Interner>(&arena), &arena);
+    start = std::chrono::steady_clock::now();
+    auto grants = shardedKeyLocks.acquireKeyLocks(requests);
+    auto batchElapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    BOOST_TEST_MESSAGE("Acquire " << requests.size()
+                                  << " key locks, one by one: " << serialElapsed.count()
+                                  << "us, batch in one pass: " << unshardedElapsed.count()
+                                  << "us, batch by shard: " << batchElapsed.count() << "us");
+
+    BOOST_CHECK(grants.granted == serialGranted);
+    BOOST_CHECK(unshardedGrants.granted == serialGranted);
+    BOOST_CHECK(!grants.denials.empty());
+    for (auto& contract : contracts)
+    {
+        auto snapshot = shardedKeyLocks.getKeyLocksSnapshot(contract);
+        auto serialSnapshot = serialKeyLocks.getKeyLocksSnapshot(contract);
+        BOOST_CHECK_EQUAL(snapshot->size(), serialSnapshot->size());
+        for (size_t i = 0; i < snapshot->size() && i < serialSnapshot->size(); ++i)
+        {
+            BOOST_CHECK_EQUAL((*snapshot)[i].key, (*serialSnapshot)[i].key);
+            BOOST_CHECK_EQUAL((*snapshot)[i].contextID, (*serialSnapshot)[i].contextID);
+        }
+    }
+    BOOST_CHECK_EQUAL(shardedKeyLocks.selectDeadLockVictims(LOWEST_PROGRESS).size(),
+        serialKeyLocks.selectDeadLockVictims(LOWEST_PROGRESS).size());
+
+    for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+    {
+        shardedKeyLocks.releaseAllKeyLocks(contextID);
+    }
+    for (auto& contract : contracts)
+    {
+        BOOST_CHECK(shardedKeyLocks.getKeyLocksSnapshot(contract)->empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(acquireKeyLocksByShardWaitEdges)
+{
+    // 1 and 2 are in a dead lock, 1 waits for the key 2 holds again in a batch served by shards
+    keyLocks.setParallelAcquireSize(2);
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract1", "key1", 1, 0));
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract2", "key2", 2, 0));
+    BOOST_CHECK(!keyLocks.acquireKeyLock("contract2", "key2", 1, 1));
+    BOOST_CHECK(!keyLocks.acquireKeyLock("contract1", "key1", 2, 1));
+
+    std::vector<scheduler::GraphKeyLocks::KeyLockRequest> requests{
+        {"contract2", "key2", 1, 2, scheduler::GraphKeyLocks::KeyLockMode::EXCLUSIVE},
+        {"contract3", "key3", 3, 0, scheduler::GraphKeyLocks::KeyLockMode::EXCLUSIVE},
+        {"contract3", "key3", 4, 0, scheduler::GraphKeyLocks::KeyLockMode::EXCLUSIVE}};
+    auto grants = keyLocks.acquireKeyLocks(requests);
+    BOOST_CHECK((grants.granted == std::vector<bool>{false, true, false}));
+
+    // One victim for the cycle, then no dead lock
+    auto victims = keyLocks.selectDeadLockVictims(scheduler::DeadLockVictimPolicy::FEWEST_LOCKS);
+    BOOST_CHECK_EQUAL(victims.size(), 1);
+    for (auto& victim : victims)
+    {
+        keyLocks.releaseAllKeyLocks(victim.contextID);
+    }
+    BOOST_CHECK(keyLocks.selectDeadLockVictims(scheduler::DeadLockVictimPolicy::FEWEST_LOCKS)
+                    .empty());
+}
+
 BOOST_AUTO_TEST_CASE(deadLock)
 {
     std::string to = "contract1";
@@ -108,6 +447,347 @@ BOOST_AUTO_TEST_CASE(deadLock)
 
     BOOST_CHECK(keyLocks.detectDeadLock(1000));
     BOOST_CHECK(keyLocks.detectDeadLock(1001));
+
+    // Both progress to seq 3, revert the younger one
+    auto victims = keyLocks.selectDeadLockVictims(LOWEST_PROGRESS);
+    BOOST_REQUIRE_EQUAL(victims.size(), 1);
+    BOOST_CHECK_EQUAL(victims.front().contextID, 1001);
+
+    // Victim reverted, dead lock broken
+    for (int64_t seq = 0; seq <= 3; ++seq)
+    {
+        keyLocks.releaseKeyLocks(1001, seq);
+    }
+    BOOST_CHECK(!keyLocks.detectDeadLock(1000));
+    BOOST_CHECK(keyLocks.selectDeadLockVictims(LOWEST_PROGRESS).empty());
+}
+
+BOOST_AUTO_TEST_CASE(deadLockVictim)
+{
+    std::string to = "contract1";
+
+    // 1000 -> 1001 -> 1002 -> 1000, 1001 with lowest seq progress
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key0", 1000, 3));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key1", 1001, 1));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key2", 1002, 2));
+
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key1", 1000, 4));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key2", 1001, 1));
+    BOOST_CHECK(keyLocks.selectDeadLockVictims(LOWEST_PROGRESS).empty());
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key0", 1002, 2));
+
+    BOOST_CHECK(keyLocks.detectDeadLock(1000));
+    BOOST_CHECK(keyLocks.detectDeadLock(1001));
+    BOOST_CHECK(keyLocks.detectDeadLock(1002));
+    // Any of the three breaks the cycle, all are candidates
+    std::vector<scheduler::DeadLockVictimCandidate> candidates;
+    auto victims = keyLocks.selectDeadLockVictims(LOWEST_PROGRESS,
+        [&candidates](scheduler::DeadLockVictimCandidate& candidate) {
+            candidates.push_back(candidate);
+        });
+    BOOST_REQUIRE_EQUAL(victims.size(), 1);
+    BOOST_CHECK_EQUAL(victims.front().contextID, 1001);
+    BOOST_CHECK_EQUAL(candidates.size(), 3);
+    for (auto& candidate : candidates)
+    {
+        BOOST_CHECK_EQUAL(candidate.holdingLocks, 1);
+    }
+
+    // Second path 1002 -> 1001 through key3, still dead lock after 1002 -> 1000 removed
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key3", 1001, 1));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key3", 1002, 2));
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key4", 1000, 3));
+    BOOST_CHECK(!keyLocks.acquireKeyLock(to, "key4", 1001, 1));
+
+    keyLocks.releaseKeyLocks(1000, 3);
+    keyLocks.releaseKeyLocks(1000, 4);
+    BOOST_CHECK(!keyLocks.detectDeadLock(1000));
+    BOOST_CHECK(keyLocks.detectDeadLock(1001));
+    BOOST_CHECK(keyLocks.detectDeadLock(1002));
+
+    // Waiting key acquired, no dead lock at all
+    keyLocks.releaseKeyLocks(1001, 1);
+    BOOST_CHECK(keyLocks.acquireKeyLock(to, "key3", 1002, 2));
+    BOOST_CHECK(!keyLocks.detectDeadLock(1002));
+    BOOST_CHECK(keyLocks.selectDeadLockVictims(LOWEST_PROGRESS).empty());
+}
+
+BOOST_AUTO_TEST_CASE(deadLockVictims)
+{
+    // Three independent cycles: (0, 1), (2, 3, 4) and (5, 6) sharing 6 with (6, 7)
+    auto cycle = [this](const std::vector<int64_t>& contexts) {
+        for (auto contextID : contexts)
+        {
+            BOOST_CHECK(keyLocks.acquireKeyLock(
+                "contract1", "key" + boost::lexical_cast<std::string>(contextID), contextID, 1));
+        }
+        for (size_t i = 0; i < contexts.size(); ++i)
+        {
+            auto next = contexts[(i + 1) % contexts.size()];
+            BOOST_CHECK(!keyLocks.acquireKeyLock(
+                "contract1", "key" + boost::lexical_cast<std::string>(next), contexts[i], 2));
+        }
+    };
+    cycle({0, 1});
+    cycle({2, 3, 4});
+    cycle({5, 6});
+    BOOST_CHECK(!keyLocks.acquireKeyLock("contract1", "key6", 7, 1));
+    BOOST_CHECK(keyLocks.acquireKeyLock("contract1", "key7", 7, 1));
+    BOOST_CHECK(!keyLocks.acquireKeyLock("contract1", "key7", 6, 2));
+
+    std::set<int64_t> filled;
+    auto victims = keyLocks.selectDeadLockVictims(scheduler::DeadLockVictimPolicy::FEWEST_LOCKS,
+        [&filled](scheduler::DeadLockVictimCandidate& candidate) {
+            BOOST_CHECK(filled.insert(candidate.contextID).second);
+            candidate.gasUsed = candidate.contextID;
+        });
+
+    // 6 breaks both cycles it's in
+    std::set<int64_t> victimIDs;
+    for (auto& victim : victims)
+    {
+        victimIDs.insert(victim.contextID);
+        BOOST_CHECK_EQUAL(victim.gasUsed, victim.contextID);
+    }
+    BOOST_CHECK_EQUAL(victims.size(), 3);
+    BOOST_CHECK(victimIDs.count(1));
+    BOOST_CHECK(victimIDs.count(4));
+    BOOST_CHECK(victimIDs.count(6));
+
+    for (auto victim : victimIDs)
+    {
+        keyLocks.releaseKeyLocks(victim, 1);
+        keyLocks.releaseKeyLocks(victim, 2);
+    }
+    BOOST_CHECK(keyLocks.selectDeadLockVictims(scheduler::DeadLockVictimPolicy::FEWEST_LOCKS)
+                    .empty());
+}
+
+BOOST_AUTO_TEST_CASE(deadLockVictimPolicy)
+{
+    std::vector<scheduler::DeadLockVictimCandidate> candidates(3);
+    candidates[0] = {1000, 5, 1, 3, 3000};
+    candidates[1] = {1001, 2, 4, 2, 9000};
+    candidates[2] = {1002, 7, 2, 1, 1000};
+
+    using scheduler::DeadLockVictimPolicy;
+    BOOST_CHECK_EQUAL(
+        chooseDeadLockVictim(DeadLockVictimPolicy::LOWEST_PROGRESS, candidates)->contextID, 1001);
+    BOOST_CHECK_EQUAL(
+        chooseDeadLockVictim(DeadLockVictimPolicy::YOUNGEST_CONTEXT, candidates)->contextID, 1002);
+    BOOST_CHECK_EQUAL(
+        chooseDeadLockVictim(DeadLockVictimPolicy::SHALLOWEST_CALL_STACK, candidates)->contextID,
+        1002);
+    BOOST_CHECK_EQUAL(
+        chooseDeadLockVictim(DeadLockVictimPolicy::LEAST_GAS, candidates)->contextID, 1002);
+    BOOST_CHECK_EQUAL(
+        chooseDeadLockVictim(DeadLockVictimPolicy::FEWEST_LOCKS, candidates)->contextID, 1000);
+    BOOST_CHECK(!chooseDeadLockVictim(DeadLockVictimPolicy::FEWEST_LOCKS, {}));
+
+    scheduler::DeadLockVictimStatistics statistics;
+    statistics.record(candidates[1]);
+    statistics.record(candidates[2]);
+    BOOST_CHECK_EQUAL(statistics.victims, 2);
+    BOOST_CHECK_EQUAL(statistics.revertedCallDepth, 3);
+    BOOST_CHECK_EQUAL(statistics.revertedGas, 10000);
+    BOOST_CHECK_EQUAL(statistics.releasedLocks, 6);
+}
+
+BOOST_AUTO_TEST_CASE(interner)
+{
+    scheduler::Interner interner;
+
+    auto contract1 = interner.internContract("contract1");
+    auto contract2 = interner.internContract("contract2");
+    BOOST_CHECK_NE(contract1, contract2);
+    BOOST_CHECK_EQUAL(interner.internContract("contract1"), contract1);
+    BOOST_CHECK_EQUAL(interner.findContract("contract2"), contract2);
+    BOOST_CHECK_EQUAL(interner.findContract("contract3"), scheduler::Interner::INVALID_CONTRACT);
+    BOOST_CHECK_EQUAL(interner.contract(contract2), "contract2");
+
+    // Same key on different contracts
+    auto key1 = interner.internKeyLock(contract1, "key");
+    auto key2 = interner.internKeyLock(contract2, "key");
+    BOOST_CHECK_NE(key1, key2);
+    BOOST_CHECK_EQUAL(interner.internKeyLock(contract1, "key"), key1);
+    BOOST_CHECK_EQUAL(interner.findKeyLock(contract2, "key"), key2);
+    BOOST_CHECK_EQUAL(
+        interner.findKeyLock(contract2, "key1"), scheduler::Interner::INVALID_KEY_LOCK);
+    BOOST_CHECK_EQUAL(interner.contractOf(key2), contract2);
+    BOOST_CHECK_EQUAL(interner.key(key1), "key");
+
+    // Survive rehash
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        BOOST_CHECK_EQUAL(
+            interner.internKeyLock(contract1, "key" + boost::lexical_cast<std::string>(i)), i + 2);
+    }
+    BOOST_CHECK_EQUAL(interner.keyLockCount(), 1002);
+    BOOST_CHECK_EQUAL(interner.findKeyLock(contract1, "key500"), 502);
+    BOOST_CHECK_EQUAL(interner.findKeyLock(contract1, "key"), key1);
+}
+
+BOOST_AUTO_TEST_CASE(acquireReleasePerformance)
+{
+    // Hot contract: every context touches 8 keys out of a small key space, half of the requests
+    // conflict with other contexts. Compared with the graph implementation replaced
+    std::string to = "contract1";
+    std::string keyPrefix = "key";
+    int64_t contextCount = 2000;
+    int64_t keyCount = 8;
+    int64_t seqCount = 4;
+
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < contextCount; ++i)
+    {
+        keys.emplace_back(keyPrefix + boost::lexical_cast<std::string>(i));
+    }
+
+    auto run = [&](auto& locks) {
+        size_t operations = 0;
+        size_t acquired = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int64_t round = 0; round < 10; ++round)
+        {
+            for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+            {
+                for (int64_t seq = 0; seq < seqCount; ++seq)
+                {
+                    for (int64_t i = 0; i < keyCount / seqCount; ++i)
+                    {
+                        auto& key = keys[(contextID / 2 + seq * 7 + i * 13) % contextCount];
+                        acquired += locks.acquireKeyLock(to, key, contextID, seq) ? 1 : 0;
+                        ++operations;
+                    }
+                }
+            }
+
+            for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+            {
+                for (int64_t seq = seqCount - 1; seq >= 0; --seq)
+                {
+                    locks.releaseKeyLocks(contextID, seq);
+                    ++operations;
+                }
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        return std::make_tuple(operations, acquired, elapsed);
+    };
+
+    MockGraphKeyLocks graphKeyLocks;
+    auto [operations, acquired, elapsed] = run(keyLocks);
+    auto [graphOperations, graphAcquired, graphElapsed] = run(graphKeyLocks);
+
+    // Same grants, everything released
+    BOOST_CHECK_EQUAL(acquired, graphAcquired);
+    BOOST_CHECK(keyLocks.getKeyLocksNotHoldingByContext(to, -1).empty());
+
+    auto throughput = [](size_t operations, std::chrono::microseconds elapsed) {
+        return operations * 1000000 / std::max<int64_t>(elapsed.count(), 1);
+    };
+    BOOST_TEST_MESSAGE("Key lock acquire/release operations: "
+                       << operations << " elapsed: " << elapsed.count()
+                       << "us throughput: " << throughput(operations, elapsed)
+                       << " ops/s, graph: " << graphElapsed.count()
+                       << "us throughput: " << throughput(graphOperations, graphElapsed)
+                       << " ops/s");
+    BOOST_WARN_LT(elapsed.count(), graphElapsed.count());
+}
+
+BOOST_AUTO_TEST_CASE(deepCallStackReleasePerformance)
+{
+    // Every context calls down a deep stack, each frame locks some keys. The stack is released seq
+    // by seq as the frames return, or at once as the transaction finishes
+    int64_t contextCount = 200;
+    int64_t depth = 64;
+    int64_t keyCount = 4;
+
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < depth * keyCount; ++i)
+    {
+        keys.emplace_back("key" + boost::lexical_cast<std::string>(i));
+    }
+
+    auto acquire = [&]() {
+        for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+        {
+            auto contract = "contract" + boost::lexical_cast<std::string>(contextID);
+            for (int64_t seq = 0; seq < depth; ++seq)
+            {
+                for (int64_t i = 0; i < keyCount; ++i)
+                {
+                    keyLocks.acquireKeyLock(contract, keys[seq * keyCount + i], contextID, seq);
+                }
+            }
+        }
+    };
+
+    std::chrono::microseconds perSeqElapsed(0);
+    std::chrono::microseconds releaseAllElapsed(0);
+    for (int64_t round = 0; round < 5; ++round)
+    {
+        acquire();
+        auto start = std::chrono::steady_clock::now();
+        for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+        {
+            for (int64_t seq = depth - 1; seq >= 0; --seq)
+            {
+                keyLocks.releaseKeyLocks(contextID, seq);
+            }
+        }
+        perSeqElapsed += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        acquire();
+        start = std::chrono::steady_clock::now();
+        for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+        {
+            keyLocks.releaseAllKeyLocks(contextID);
+        }
+        releaseAllElapsed += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+
+    BOOST_TEST_MESSAGE("Release " << contextCount << " contexts with call depth " << depth
+                                  << ", per seq: " << perSeqElapsed.count()
+                                  << "us, all at once: " << releaseAllElapsed.count() << "us");
+    BOOST_WARN_LT(releaseAllElapsed.count(), perSeqElapsed.count());
+
+    for (int64_t contextID = 0; contextID < contextCount; ++contextID)
+    {
+        BOOST_CHECK(keyLocks
+                        .getKeyLocksNotHoldingByContext(
+                            "contract" + boost::lexical_cast<std::string>(contextID), -1)
+                        .empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(contextChurnMemory)
+{
+    // Contexts come and go through a block, their entries are reused instead of taking new memory
+    // from the block's arena
+    scheduler::BlockArena arena;
+    auto interner = std::make_shared<scheduler::Interner>(&arena);
+    scheduler::GraphKeyLocks arenaKeyLocks(interner, &arena);
+    auto churn = [&arenaKeyLocks](int64_t begin, int64_t end) {
+        for (auto contextID = begin; contextID < end; ++contextID)
+        {
+            for (int64_t seq = 0; seq < 4; ++seq)
+            {
+                BOOST_CHECK(arenaKeyLocks.acquireKeyLock(
+                    "contract", "key" + boost::lexical_cast<std::string>(seq), contextID, seq));
+            }
+            arenaKeyLocks.releaseKeyLocks(contextID, 3);
+            arenaKeyLocks.releaseAllKeyLocks(contextID);
+        }
+    };
+
+    churn(0, 1000);
+    auto upstreamBytes = arena.upstreamBytes();
+    churn(1000, 100000);
+    BOOST_CHECK_EQUAL(arena.upstreamBytes(), upstreamBytes);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,16 +12,26 @@
 #include "interfaces/protocol/TransactionSubmitResult.h"
 #include "interfaces/storage/StorageInterface.h"
 #include "libprotocol/TransactionSubmitResultFactoryImpl.h"
+#include "mock/MockBatchExecutor.h"
 #include "mock/MockDeadLockExecutor.h"
 #include "mock/MockExecutor.h"
 #include "mock/MockExecutor3.h"
 #include "mock/MockExecutorForCall.h"
 #include "mock/MockExecutorForCreate.h"
 #include "mock/MockExecutorForMessageDAG.h"
+#include "mock/MockHotContractExecutor.h"
+#include "mock/MockKeyLockDeltaExecutor.h"
+#include "mock/MockKeyLockLoopExecutor.h"
 #include "mock/MockLedger.h"
 #include "mock/MockMultiParallelExecutor.h"
 #include "mock/MockRPC.h"
+#include "mock/MockSlowNextBlockExecutor.h"
+#include "mock/MockSkewedLatencyExecutor.h"
+#include "mock/MockSpeculativeExecutor.h"
+#include "mock/MockStaticCallWriterExecutor.h"
+#include "mock/MockTokenExecutor.h"
 #include "mock/MockTransactionalStorage.h"
+#include "mock/MockWorkerPoolExecutor.h"
 #include <bcos-framework/interfaces/executor/PrecompiledTypeDef.h>
 #include <bcos-framework/libexecutor/NativeExecutionMessage.h>
 #include <bcos-framework/testutils/crypto/HashImpl.h>
@@ -35,8 +45,11 @@
 #include <boost/test/tools/old/interface.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/thread/latch.hpp>
+#include <functional>
 #include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace bcos::test
 {
@@ -99,6 +112,79 @@ struct SchedulerFixture
         keyPair = suite->signatureImpl()->generateKeyPair();
     }
 
+    // Transactions sent to `contracts` in order, hashed by their index from 1
+    bcos::protocol::Block::Ptr makeBlock(
+        const std::vector<std::string>& contracts, bcos::protocol::BlockNumber number = 100)
+    {
+        auto block = blockFactory->createBlock();
+        block->blockHeader()->setNumber(number);
+        for (size_t i = 0; i < contracts.size(); ++i)
+        {
+            block->appendTransactionMetaData(
+                std::make_shared<bcostars::protocol::TransactionMetaDataImpl>(
+                    h256(i + 1), contracts[i]));
+        }
+        return block;
+    }
+
+    // `count` contracts named `prefix`0 to `prefix`<contracts - 1> in turn
+    static std::vector<std::string> inTurn(
+        const std::string& prefix, size_t count, size_t contracts)
+    {
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            names.push_back(prefix + boost::lexical_cast<std::string>(i % contracts));
+        }
+        return names;
+    }
+
+    bcos::protocol::BlockHeader::Ptr executeBlockOn(
+        scheduler::SchedulerImpl& schedulerImpl, bcos::protocol::Block::Ptr block)
+    {
+        std::promise<bcos::protocol::BlockHeader::Ptr> executedHeader;
+        schedulerImpl.executeBlock(std::move(block), false,
+            [&](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&& header) {
+                BOOST_CHECK(!error);
+                executedHeader.set_value(std::move(header));
+            });
+        auto header = executedHeader.get_future().get();
+        BOOST_CHECK(header);
+        return header;
+    }
+
+    struct ExecutedBlock
+    {
+        std::shared_ptr<scheduler::SchedulerImpl> scheduler;
+        bcos::protocol::Block::Ptr block;
+        bcos::protocol::BlockHeader::Ptr header;
+    };
+
+    // Executes a block of transactions sent to `contracts` on a new scheduler of the one executor,
+    // in `mode` even if timing dependent. `configure` sets the scheduler up further
+    ExecutedBlock executeBlockWith(
+        bcos::executor::ParallelTransactionExecutorInterface::Ptr executor,
+        scheduler::DMTScheduleMode mode, const std::vector<std::string>& contracts,
+        const std::function<void(scheduler::SchedulerImpl&)>& configure = {})
+    {
+        auto manager = std::make_shared<scheduler::ExecutorManager>();
+        manager->addExecutor("executor1", std::move(executor));
+
+        auto schedulerImpl = std::make_shared<scheduler::SchedulerImpl>(manager, ledger, storage,
+            executionMessageFactory, blockFactory, transactionSubmitResultFactory, hashImpl, true);
+        schedulerImpl->setDMTScheduleMode(mode);
+        schedulerImpl->setNondeterministicScheduleAllowed(true);
+        if (configure)
+        {
+            configure(*schedulerImpl);
+        }
+
+        auto block = makeBlock(contracts);
+        auto header = executeBlockOn(*schedulerImpl, block);
+        return {std::move(schedulerImpl), std::move(block), std::move(header)};
+    }
+
     ledger::LedgerInterface::Ptr ledger;
     scheduler::ExecutorManager::Ptr executorManager;
     std::shared_ptr<MockTransactionalStorage> storage;
@@ -636,5 +722,622 @@ BOOST_AUTO_TEST_CASE(executeWithDeadLock)
         });
 }
 
+BOOST_AUTO_TEST_CASE(executeWithMultipleDeadLocks)
+{
+    auto executor = std::make_shared<MockDeadLockParallelExecutor>("executor11");
+    executor->m_contextCount = 6;
+    executorManager->addExecutor("executor11", executor);
+
+    auto block = blockFactory->createBlock();
+    block->blockHeader()->setNumber(901);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        auto metaTx = std::make_shared<bcostars::protocol::TransactionMetaDataImpl>(
+            h256(i + 1), "contract" + boost::lexical_cast<std::string>(i + 1));
+        block->appendTransactionMetaData(std::move(metaTx));
+    }
+
+    auto schedulerImpl = std::dynamic_pointer_cast<scheduler::SchedulerImpl>(scheduler);
+    auto& statistics =
+        schedulerImpl->deadLockVictimStatistics(scheduler::DeadLockVictimPolicy::LOWEST_PROGRESS);
+    size_t victims = statistics.victims;
+
+    scheduler->executeBlock(
+        block, false, [](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&& blockHeader) {
+            BOOST_CHECK(!error);
+            BOOST_CHECK(blockHeader);
+        });
+
+    // Three independent dead locks, one victim each
+    BOOST_CHECK_EQUAL(statistics.victims - victims, 3);
+}
+
+BOOST_AUTO_TEST_CASE(eventDrivenDeadLocks)
+{
+    auto executor = std::make_shared<MockDeadLockParallelExecutor>("executor12");
+    executor->m_contextCount = 6;
+    executorManager->addExecutor("executor12", executor);
+
+    auto block = blockFactory->createBlock();
+    block->blockHeader()->setNumber(902);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        auto metaTx = std::make_shared<bcostars::protocol::TransactionMetaDataImpl>(
+            h256(i + 1), "contract" + boost::lexical_cast<std::string>(i + 1));
+        block->appendTransactionMetaData(std::move(metaTx));
+    }
+
+    auto schedulerImpl = std::dynamic_pointer_cast<scheduler::SchedulerImpl>(scheduler);
+    schedulerImpl->setDMTScheduleMode(scheduler::DMTScheduleMode::EVENT_DRIVEN);
+    schedulerImpl->setNondeterministicScheduleAllowed(true);
+    auto& statistics =
+        schedulerImpl->deadLockVictimStatistics(scheduler::DeadLockVictimPolicy::LOWEST_PROGRESS);
+    size_t victims = statistics.victims;
+
+    scheduler->executeBlock(
+        block, false, [](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&& blockHeader) {
+            BOOST_CHECK(!error);
+            BOOST_CHECK(blockHeader);
+        });
+
+    BOOST_CHECK_EQUAL(statistics.victims - victims, 3);
+}
+
+BOOST_AUTO_TEST_CASE(eventDrivenTailLatency)
+{
+    // A slow call holds a whole batch in lock step, the first transaction of every contract
+    // finishes before any second one. Event driven, the other contracts go on past the slow call
+    auto finishOrder = [this](scheduler::DMTScheduleMode mode) {
+        auto executor = std::make_shared<MockSkewedLatencyExecutor>("executor1");
+        auto executed = executeBlockWith(executor, mode, inTurn("contract", 64, 16));
+
+        // The last callback may still be returning on the worker
+        executor->stop();
+        auto finished = executor->finished();
+        BOOST_CHECK_EQUAL(finished.size(), 64);
+        auto second = std::find_if(
+            finished.begin(), finished.end(), [](int64_t contextID) { return contextID >= 16; });
+        return static_cast<size_t>(second - finished.begin());
+    };
+
+    BOOST_CHECK_EQUAL(finishOrder(scheduler::DMTScheduleMode::LOCK_STEP), 16);
+    BOOST_CHECK_LT(finishOrder(scheduler::DMTScheduleMode::EVENT_DRIVEN), 16);
+}
+
+BOOST_AUTO_TEST_CASE(eventDrivenGuard)
+{
+    // Blocks follow the executors' timing in event driven mode only if allowed
+    auto executeWithAllowed = [this](bool allowed) {
+        auto executor = std::make_shared<MockSkewedLatencyExecutor>("executor1");
+        auto executed = executeBlockWith(executor, scheduler::DMTScheduleMode::EVENT_DRIVEN,
+            inTurn("contract", 8, 8), [allowed](scheduler::SchedulerImpl& schedulerImpl) {
+                schedulerImpl.setNondeterministicScheduleAllowed(allowed);
+            });
+        executor->stop();
+        BOOST_CHECK_EQUAL(executor->latencies().size(), 8);
+        return executed.scheduler->lastScheduleMode();
+    };
+
+    BOOST_CHECK(executeWithAllowed(false) == scheduler::DMTScheduleMode::LOCK_STEP);
+    BOOST_CHECK(executeWithAllowed(true) == scheduler::DMTScheduleMode::EVENT_DRIVEN);
+}
+
+BOOST_AUTO_TEST_CASE(hotContractInflightWindow)
+{
+    // Every transaction reads one hot contract by a static call
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        for (size_t window : {1, 16})
+        {
+            auto executor = std::make_shared<MockHotContractExecutor>("executor1");
+            auto executed = executeBlockWith(executor, mode, inTurn("caller", 128, 128),
+                [window](scheduler::SchedulerImpl& schedulerImpl) {
+                    schedulerImpl.setContractInflightWindow(window);
+                });
+
+            executor->stop();
+            BOOST_CHECK_EQUAL(executor->latencies().size(), 128);
+            BOOST_CHECK_LE(executor->m_maxExecuting, window);
+            if (window > 1)
+            {
+                BOOST_CHECK_GT(executor->m_maxExecuting, 1);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(staticCallFromWriter)
+{
+    // The writer keeps its key exclusive through its static call, readers wait for it
+    auto contracts = inTurn("reader", 16, 16);
+    contracts[0] = "shared";
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        auto executor = std::make_shared<MockStaticCallWriterExecutor>("executor1");
+        auto executed = executeBlockWith(
+            executor, mode, contracts, [](scheduler::SchedulerImpl& schedulerImpl) {
+                schedulerImpl.setContractInflightWindow(16);
+            });
+
+        executor->stop();
+        BOOST_CHECK_EQUAL(executor->latencies().size(), 16);
+        BOOST_CHECK_EQUAL(executor->m_dirtyReads, 0);
+        BOOST_CHECK_EQUAL(executor->m_overlaps, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(staticCallsNextToWriter)
+{
+    // Readers of another key share the contract while the writer holds its key in a static call
+    auto contracts = inTurn("reader", 16, 16);
+    contracts[0] = "shared";
+    auto executor = std::make_shared<MockStaticCallWriterExecutor>("executor1");
+    executor->m_readKey = "other";
+    auto executed = executeBlockWith(executor, scheduler::DMTScheduleMode::LOCK_STEP, contracts,
+        [](scheduler::SchedulerImpl& schedulerImpl) {
+            schedulerImpl.setNondeterministicScheduleAllowed(false);
+            schedulerImpl.setContractInflightWindow(16);
+        });
+
+    executor->stop();
+    BOOST_CHECK_EQUAL(executor->latencies().size(), 16);
+    BOOST_CHECK_EQUAL(executor->m_dirtyReads, 0);
+    BOOST_CHECK_EQUAL(executor->m_overlaps, 0);
+    BOOST_CHECK_EQUAL(executor->m_readsNextToWriter, 15);
+    BOOST_CHECK_GT(executor->m_maxReading, 1);
+}
+
+BOOST_AUTO_TEST_CASE(declaredWritersInflightWindow)
+{
+    // Transfers of one token contract, writers of disjoint declared accounts execute at once. Some
+    // pay a fee into an undeclared account or share accounts, the balances are the ones of writers
+    // executed one by one
+    const std::vector<std::tuple<int64_t, int64_t>> blocks{{1024, 0}, {1024, 4}, {16, 4}};
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        for (auto [accounts, feeRatio] : blocks)
+        {
+            auto transfer = [&, accounts = accounts, feeRatio = feeRatio](
+                                bool declaring, size_t window) {
+                auto executor = std::make_shared<MockTokenExecutor>("executor1");
+                executor->m_declaring = declaring;
+                executor->m_accounts = accounts;
+                executor->m_feeRatio = feeRatio;
+                auto executed = executeBlockWith(executor, mode,
+                    std::vector<std::string>(128, "token"),
+                    [window](scheduler::SchedulerImpl& schedulerImpl) {
+                        schedulerImpl.setContractInflightWindow(window);
+                    });
+
+                executor->stop();
+                BOOST_CHECK_EQUAL(executor->latencies().size(), 128);
+                BOOST_CHECK_EQUAL(executor->m_races, 0);
+                BOOST_CHECK_LE(executor->m_maxExecuting, window);
+                return executor;
+            };
+
+            auto oneByOne = transfer(false, 16);
+            BOOST_CHECK_EQUAL(oneByOne->m_maxExecuting, 1);
+
+            auto declared = transfer(true, 16);
+            BOOST_CHECK_GT(declared->m_maxExecuting, 1);
+            BOOST_CHECK(declared->balances() == oneByOne->balances());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batchExecutorCalls)
+{
+    // Same block with an executor taking one message per call or a whole round per call
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        auto single = std::make_shared<MockInProcessExecutor>("executor1");
+        executeBlockWith(single, mode, inTurn("contract", 256, 64));
+        BOOST_CHECK_EQUAL(single->m_messages, 256 * single->m_steps);
+        BOOST_CHECK_EQUAL(single->m_calls, 256 * single->m_steps);
+
+        auto batch = std::make_shared<MockBatchExecutor>("executor1");
+        executeBlockWith(batch, mode, inTurn("contract", 256, 64));
+        BOOST_CHECK_EQUAL(batch->m_messages, 256 * batch->m_steps);
+        BOOST_CHECK_LT(batch->m_calls, 256 * batch->m_steps);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockArena)
+{
+    auto executor = std::make_shared<MockInProcessExecutor>("executor1");
+    auto executed = executeBlockWith(
+        executor, scheduler::DMTScheduleMode::LOCK_STEP, inTurn("contract", 1024, 256));
+
+    // The block's bookkeeping is served by a few heap chunks
+    auto& statistics = executed.scheduler->blockArenaStatistics();
+    BOOST_CHECK_EQUAL(statistics.blocks, 1);
+    BOOST_CHECK_GT(statistics.allocations, statistics.upstreamAllocations * 10);
+    BOOST_TEST_MESSAGE("Arena allocations: " << statistics.allocations << " bytes: "
+                                             << statistics.allocatedBytes
+                                             << " heap allocations: "
+                                             << statistics.upstreamAllocations
+                                             << " heap bytes: " << statistics.upstreamBytes);
+}
+
+BOOST_AUTO_TEST_CASE(transactionInputReference)
+{
+    auto executor = std::make_shared<MockInProcessExecutor>("executor1");
+    auto manager = std::make_shared<scheduler::ExecutorManager>();
+    manager->addExecutor("executor1", executor);
+
+    auto schedulerImpl = std::make_shared<scheduler::SchedulerImpl>(manager, ledger, storage,
+        executionMessageFactory, blockFactory, transactionSubmitResultFactory, hashImpl, true);
+
+    auto block = blockFactory->createBlock();
+    block->blockHeader()->setNumber(100);
+    auto keyPair = blockFactory->cryptoSuite()->signatureImpl()->generateKeyPair();
+    for (size_t i = 0; i < 100; ++i)
+    {
+        bytes input(64, static_cast<byte>(i));
+        auto tx = blockFactory->transactionFactory()->createTransaction(0,
+            "contract" + boost::lexical_cast<std::string>(i % 10), input, 100, 200, "chainID",
+            "groupID", 400, keyPair);
+        block->appendTransaction(tx);
+    }
+
+    std::promise<bcos::protocol::BlockHeader::Ptr> executedHeader;
+    schedulerImpl->executeBlock(
+        block, false, [&](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&& header) {
+            BOOST_CHECK(!error);
+            executedHeader.set_value(std::move(header));
+        });
+    BOOST_CHECK(executedHeader.get_future().get());
+
+    // Messages refer to the input all the way, nothing is copied
+    auto& statistics = schedulerImpl->transactionInputStatistics();
+    BOOST_CHECK_EQUAL(statistics.referencedBytes, 100 * 64);
+    BOOST_CHECK_EQUAL(statistics.copiedBytes, 0);
+
+    // Taking the data copies it once, new data replaces the reference. The statistics live as long
+    // as a message kept by an executor
+    auto tx = block->transaction(0);
+    auto copies = std::make_shared<scheduler::TransactionInputStatistics>();
+    std::weak_ptr<scheduler::TransactionInputStatistics> kept = copies;
+    scheduler::TransactionInputMessage message(tx, std::move(copies));
+    BOOST_CHECK_EQUAL(message.data().data(), tx->input().data());
+    BOOST_REQUIRE(!kept.expired());
+    BOOST_CHECK(message.takeData() == tx->input().toBytes());
+    BOOST_CHECK_EQUAL(kept.lock()->copiedBytes, 64);
+    BOOST_CHECK_EQUAL(message.data().size(), 0);
+
+    scheduler::TransactionInputMessage replaced(tx, kept.lock());
+    replaced.setData(bytes(8, 1));
+    BOOST_CHECK_EQUAL(replaced.data().size(), 8);
+    BOOST_CHECK_EQUAL(kept.lock()->copiedBytes, 64);
+}
+
+BOOST_AUTO_TEST_CASE(nextBlockPerExecutor)
+{
+    // A slow executor switching to the block doesn't hold the others
+    auto fast = std::make_shared<MockSlowNextBlockExecutor>("executor1");
+    auto slow = std::make_shared<MockSlowNextBlockExecutor>("executor2");
+    slow->m_nextBlockDelay = std::chrono::milliseconds(50);
+    auto manager = std::make_shared<scheduler::ExecutorManager>();
+    manager->addExecutor("executor1", fast);
+    manager->addExecutor("executor2", slow);
+
+    auto schedulerImpl = std::make_shared<scheduler::SchedulerImpl>(manager, ledger, storage,
+        executionMessageFactory, blockFactory, transactionSubmitResultFactory, hashImpl, true);
+
+    auto block = blockFactory->createBlock();
+    block->blockHeader()->setNumber(100);
+    for (size_t i = 0; i < 64; ++i)
+    {
+        auto metaTx = std::make_shared<bcostars::protocol::TransactionMetaDataImpl>(
+            h256(i + 1), "contract" + boost::lexical_cast<std::string>(i % 16));
+        block->appendTransactionMetaData(std::move(metaTx));
+    }
+
+    std::promise<bcos::protocol::BlockHeader::Ptr> executedHeader;
+    schedulerImpl->executeBlock(
+        block, false, [&](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&& header) {
+            BOOST_CHECK(!error);
+            executedHeader.set_value(std::move(header));
+        });
+    BOOST_CHECK(executedHeader.get_future().get());
+    fast->stop();
+    slow->stop();
+
+    BOOST_CHECK_GT(fast->m_messages, 0);
+    BOOST_CHECK_GT(slow->m_messages, 0);
+    BOOST_CHECK_EQUAL(fast->m_messages + slow->m_messages, 64 * fast->m_steps);
+    BOOST_CHECK_EQUAL(slow->m_earlyMessages, 0);
+    BOOST_CHECK(fast->m_firstMessageTime && slow->m_acknowledgedTime);
+    BOOST_CHECK(*fast->m_firstMessageTime < *slow->m_acknowledgedTime);
+}
+
+BOOST_AUTO_TEST_CASE(criticalPathDispatch)
+{
+    // Skewed block on 4 workers: 128 light contracts of 2 transactions come first, then 2 heavy
+    // contracts of 64 transactions bounding the block
+    auto contracts = inTurn("light", 256, 128);
+    for (auto& heavy : inTurn("heavy", 128, 2))
+    {
+        contracts.push_back(heavy);
+    }
+    auto executeWithOrder = [this, &contracts](scheduler::DMTScheduleMode mode,
+                                scheduler::DMTDispatchOrder order,
+                                std::chrono::microseconds heavyCost) {
+        auto executor = std::make_shared<MockWorkerPoolExecutor>("executor1", 4);
+        executor->m_defaultCost = std::chrono::microseconds(100);
+        executor->m_costs["heavy0"] = heavyCost;
+        executor->m_costs["heavy1"] = heavyCost;
+        auto executed =
+            executeBlockWith(executor, mode, contracts, [order](scheduler::SchedulerImpl& s) {
+                s.setDMTDispatchOrder(order);
+                s.setDMTInflightLimit(4);
+            });
+
+        executor->stop();
+        BOOST_CHECK_LE(executor->maxPending(), 4);
+        return executor->dispatched();
+    };
+
+    // The heavy contracts go first on the critical path, the light ones in contract order
+    constexpr std::chrono::microseconds heavyCost{200};
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        auto contractOrder =
+            executeWithOrder(mode, scheduler::DMTDispatchOrder::CONTRACT, heavyCost);
+        auto criticalPath =
+            executeWithOrder(mode, scheduler::DMTDispatchOrder::CRITICAL_PATH, heavyCost);
+        BOOST_REQUIRE_EQUAL(contractOrder.size(), 384);
+        BOOST_REQUIRE_EQUAL(criticalPath.size(), 384);
+        BOOST_CHECK_LT(contractOrder.front(), 256);
+        BOOST_CHECK_GE(criticalPath.front(), 256);
+    }
+
+    // The order only depends on the block, a node with other execution times dispatches the same
+    auto dispatched = executeWithOrder(scheduler::DMTScheduleMode::LOCK_STEP,
+        scheduler::DMTDispatchOrder::CRITICAL_PATH, heavyCost);
+    auto fastDispatched = executeWithOrder(scheduler::DMTScheduleMode::LOCK_STEP,
+        scheduler::DMTDispatchOrder::CRITICAL_PATH, std::chrono::microseconds(10));
+    BOOST_CHECK(dispatched == fastDispatched);
+}
+
+BOOST_AUTO_TEST_CASE(keyLockDeltas)
+{
+    // Same block with an executor taking key lock lists in messages or changes of its tables
+    auto executeWith = [this](std::shared_ptr<MockHotKeyExecutor> executor,
+                           scheduler::DMTScheduleMode mode) {
+        auto executed = executeBlockWith(executor, mode, std::vector<std::string>(128, "hot"));
+        auto& statistics = executed.scheduler->keyLockTransferStatistics();
+        return std::make_tuple(
+            executor->hotKeyLocks(), statistics.listBytes.load(), statistics.deltaBytes.load());
+    };
+
+    for (auto mode :
+        {scheduler::DMTScheduleMode::LOCK_STEP, scheduler::DMTScheduleMode::EVENT_DRIVEN})
+    {
+        auto [listKeyLocks, listBytes, listDeltaBytes] =
+            executeWith(std::make_shared<MockHotKeyExecutor>("executor1"), mode);
+
+        auto deltaExecutor = std::make_shared<MockKeyLockDeltaExecutor>("executor1");
+        auto [deltaKeyLocks, deltaListBytes, deltaBytes] = executeWith(deltaExecutor, mode);
+
+        // Every message sees the key locks the lists carry
+        BOOST_CHECK_EQUAL(listKeyLocks.size(), 256);
+        BOOST_CHECK(listKeyLocks == deltaKeyLocks);
+        BOOST_CHECK_EQUAL(listDeltaBytes, 0);
+        BOOST_CHECK_EQUAL(deltaListBytes, 0);
+        BOOST_CHECK_EQUAL(deltaExecutor->m_keyLocksInMessages, 0);
+        BOOST_CHECK_EQUAL(deltaExecutor->m_versionMismatches, 0);
+        BOOST_CHECK_GT(deltaExecutor->m_deltas, 0);
+        BOOST_CHECK_LT(deltaBytes, listBytes);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(optimisticExecute)
+{
+    // Conflicting transactions executed by the DMT or speculated and validated
+    auto executeWithMode = [this](scheduler::DMTScheduleMode mode) {
+        auto executor = std::make_shared<MockSpeculativeExecutor>("executor1");
+        auto executed = executeBlockWith(executor, mode, inTurn("contract", 200, 4));
+
+        std::vector<bcos::crypto::HashType> receipts;
+        for (size_t i = 0; i < executed.block->receiptsSize(); ++i)
+        {
+            receipts.push_back(executed.block->receipt(i)->hash());
+        }
+        return std::make_tuple(executed.header, receipts, executor);
+    };
+    auto [lockStepHeader, lockStepReceipts, lockStepExecutor] =
+        executeWithMode(scheduler::DMTScheduleMode::LOCK_STEP);
+    auto [eventHeader, eventReceipts, eventExecutor] =
+        executeWithMode(scheduler::DMTScheduleMode::EVENT_DRIVEN);
+    auto [optimisticHeader, optimisticReceipts, optimisticExecutor] =
+        executeWithMode(scheduler::DMTScheduleMode::OPTIMISTIC);
+    BOOST_TEST_MESSAGE("Speculations: " << optimisticExecutor->m_speculations);
+
+    BOOST_CHECK_EQUAL(lockStepReceipts.size(), 200);
+    BOOST_CHECK(lockStepReceipts == eventReceipts);
+    BOOST_CHECK(lockStepReceipts == optimisticReceipts);
+    for (auto& header : {eventHeader, optimisticHeader})
+    {
+        BOOST_CHECK_EQUAL(header->stateRoot(), lockStepHeader->stateRoot());
+        BOOST_CHECK_EQUAL(header->receiptsRoot(), lockStepHeader->receiptsRoot());
+        BOOST_CHECK_EQUAL(header->gasUsed(), lockStepHeader->gasUsed());
+    }
+
+    // Transactions reading a key written by an earlier one of their contract are speculated again
+    // once, after the writers are applied
+    size_t conflicting = 0;
+    int64_t keys = optimisticExecutor->m_keys;
+    for (int64_t i = 0; i < 200; ++i)
+    {
+        for (auto j = i % 4; j < i; j += 4)
+        {
+            if (j % 10 != 9 && (j % keys == i * 7 % keys || j % keys == i % keys))
+            {
+                ++conflicting;
+                break;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(lockStepExecutor->m_speculations, 0);
+    BOOST_CHECK_EQUAL(optimisticExecutor->m_executions, 0);
+    BOOST_CHECK_EQUAL(optimisticExecutor->m_speculations, 200 + conflicting);
+}
+
+BOOST_AUTO_TEST_CASE(adaptiveScheduleMode)
+{
+    // Blocks executed in the chosen modes and by another node in lock step, to the same results
+    auto makeScheduler = [this](bcos::executor::ParallelTransactionExecutorInterface::Ptr executor,
+                             scheduler::DMTScheduleMode mode) {
+        auto manager = std::make_shared<scheduler::ExecutorManager>();
+        manager->addExecutor("executor1", std::move(executor));
+        auto schedulerImpl = std::make_shared<scheduler::SchedulerImpl>(manager, ledger, storage,
+            executionMessageFactory, blockFactory, transactionSubmitResultFactory, hashImpl, true);
+        schedulerImpl->setDMTScheduleMode(mode);
+        return schedulerImpl;
+    };
+    auto executor = std::make_shared<MockSpeculativeExecutor>("executor1");
+    auto lockStepExecutor = std::make_shared<MockSpeculativeExecutor>("executor1");
+    auto adaptive = makeScheduler(executor, scheduler::DMTScheduleMode::ADAPTIVE);
+    auto lockStep = makeScheduler(lockStepExecutor, scheduler::DMTScheduleMode::LOCK_STEP);
+
+    bcos::protocol::BlockNumber blockNumber = 100;
+    auto executeWithContracts = [&](size_t contracts) {
+        auto block = makeBlock(inTurn("contract", 200, contracts), blockNumber);
+        auto header = executeBlockOn(*adaptive, block);
+        auto lockStepBlock = makeBlock(inTurn("contract", 200, contracts), blockNumber++);
+        auto lockStepHeader = executeBlockOn(*lockStep, lockStepBlock);
+
+        BOOST_REQUIRE_EQUAL(block->receiptsSize(), 200);
+        for (size_t i = 0; i < block->receiptsSize(); ++i)
+        {
+            BOOST_CHECK_EQUAL(block->receipt(i)->hash(), lockStepBlock->receipt(i)->hash());
+        }
+        BOOST_CHECK_EQUAL(header->stateRoot(), lockStepHeader->stateRoot());
+        BOOST_CHECK_EQUAL(header->receiptsRoot(), lockStepHeader->receiptsRoot());
+
+        auto choice = adaptive->executionModeSelector().lastChoice();
+        BOOST_REQUIRE(choice);
+        BOOST_TEST_MESSAGE("Block " << blockNumber - 1 << ": " << choice->reason);
+        return choice->mode;
+    };
+
+    // Single contract blocks are speculated until speculations conflict
+    for (auto& it : {executor, lockStepExecutor})
+    {
+        it->m_keys = 1024;
+    }
+    BOOST_CHECK(executeWithContracts(1) == scheduler::DMTScheduleMode::OPTIMISTIC);
+    BOOST_REQUIRE(adaptive->executionModeSelector().conflictRate());
+    BOOST_CHECK_LT(*adaptive->executionModeSelector().conflictRate(),
+        scheduler::ExecutionModeSelector::OPTIMISTIC_CONFLICT_RATE);
+
+    for (auto& it : {executor, lockStepExecutor})
+    {
+        it->m_keys = 8;
+    }
+    size_t optimisticBlocks = 0;
+    while (executeWithContracts(1) == scheduler::DMTScheduleMode::OPTIMISTIC &&
+           optimisticBlocks < 8)
+    {
+        ++optimisticBlocks;
+    }
+    BOOST_CHECK_GT(optimisticBlocks, 0);
+    BOOST_CHECK_GT(*adaptive->executionModeSelector().conflictRate(),
+        scheduler::ExecutionModeSelector::OPTIMISTIC_CONFLICT_RATE);
+
+    // Serial for a while, then speculated again
+    for (size_t i = 1; i < scheduler::ExecutionModeSelector::SERIAL_BLOCKS; ++i)
+    {
+        BOOST_CHECK(executeWithContracts(1) == scheduler::DMTScheduleMode::SERIAL);
+    }
+    BOOST_CHECK(executeWithContracts(1) == scheduler::DMTScheduleMode::OPTIMISTIC);
+
+    // Blocks of many contracts go to the DMT in lock step
+    auto speculations = executor->m_speculations;
+    BOOST_CHECK(executeWithContracts(4) == scheduler::DMTScheduleMode::LOCK_STEP);
+    BOOST_CHECK_EQUAL(executor->m_speculations, speculations);
+
+    // DAG transactions, then a single contract without a speculative executor
+    scheduler::ExecutionModeSelector selector;
+    scheduler::ExecutionModeSelector::BlockFeatures features;
+    features.transactions = 200;
+    features.contracts = 1;
+    features.dagTransactions = 100;
+    BOOST_CHECK(selector.choose(features).mode == scheduler::DMTScheduleMode::LOCK_STEP);
+    features.dagTransactions = 0;
+    BOOST_CHECK(selector.choose(features).mode == scheduler::DMTScheduleMode::SERIAL);
+
+    // Optimistic blocks execute serially without a speculative executor, to the lock step results
+    auto executeWithMode = [this](scheduler::DMTScheduleMode mode) {
+        auto hotKeyExecutor = std::make_shared<MockHotKeyExecutor>("executor1");
+        auto executed =
+            executeBlockWith(hotKeyExecutor, mode, std::vector<std::string>(64, "hot"));
+        BOOST_CHECK_EQUAL(executed.block->receiptsSize(), 64);
+        return executed;
+    };
+    auto plain = executeWithMode(scheduler::DMTScheduleMode::OPTIMISTIC);
+    auto plainLockStep = executeWithMode(scheduler::DMTScheduleMode::LOCK_STEP);
+    BOOST_CHECK(plain.scheduler->lastScheduleMode() == scheduler::DMTScheduleMode::SERIAL);
+    BOOST_CHECK_EQUAL(plain.header->receiptsRoot(), plainLockStep.header->receiptsRoot());
+    BOOST_CHECK_EQUAL(plain.header->gasUsed(), plainLockStep.header->gasUsed());
+}
+
+BOOST_AUTO_TEST_CASE(serialExecute)
+{
+    // A single contract block, every transaction calls a callee and returns, by the DMT or serially
+    auto executeWithMode = [this](scheduler::DMTScheduleMode mode) {
+        auto executor = std::make_shared<MockHotKeyExecutor>("executor1");
+        executor->m_calleeSteps = 1;
+        auto executed = executeBlockWith(executor, mode, std::vector<std::string>(250, "hot"));
+        BOOST_CHECK_EQUAL(executed.block->receiptsSize(), 250);
+        return std::make_tuple(executed.header, executor->hotKeyLocks());
+    };
+
+    auto [lockStepHeader, lockStepKeyLocks] =
+        executeWithMode(scheduler::DMTScheduleMode::LOCK_STEP);
+    auto [serialHeader, serialKeyLocks] = executeWithMode(scheduler::DMTScheduleMode::SERIAL);
+
+    // Same results without a key lock in any message
+    BOOST_CHECK_EQUAL(serialHeader->receiptsRoot(), lockStepHeader->receiptsRoot());
+    BOOST_CHECK_EQUAL(serialHeader->gasUsed(), lockStepHeader->gasUsed());
+    BOOST_CHECK_EQUAL(lockStepKeyLocks.size(), 500);
+    BOOST_CHECK_EQUAL(serialKeyLocks.size(), 500);
+    for (auto& [context, keyLocks] : serialKeyLocks)
+    {
+        BOOST_CHECK(keyLocks.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(serialExecuteRepeatedKeyLock)
+{
+    // A transaction asking for a key lock again after it was sent on fails the block
+    auto executor = std::make_shared<MockKeyLockLoopExecutor>("executor1");
+    auto manager = std::make_shared<scheduler::ExecutorManager>();
+    manager->addExecutor("executor1", executor);
+
+    auto schedulerImpl = std::make_shared<scheduler::SchedulerImpl>(manager, ledger, storage,
+        executionMessageFactory, blockFactory, transactionSubmitResultFactory, hashImpl, true);
+    schedulerImpl->setDMTScheduleMode(scheduler::DMTScheduleMode::SERIAL);
+
+    std::promise<bcos::Error::Ptr> executedError;
+    schedulerImpl->executeBlock(makeBlock(std::vector<std::string>(8, "contract")), false,
+        [&](bcos::Error::Ptr&& error, bcos::protocol::BlockHeader::Ptr&&) {
+            executedError.set_value(std::move(error));
+        });
+    auto error = executedError.get_future().get();
+    BOOST_REQUIRE(error);
+    BOOST_CHECK_EQUAL(error->errorCode(), scheduler::SchedulerError::UnknownError);
+    BOOST_CHECK(boost::diagnostic_information(*error).find("repeated key lock") !=
+                std::string::npos);
+    BOOST_CHECK_EQUAL(executor->m_keyLockAsks, 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }  // namespace bcos::test
\ No newline at end of file